@@ -20,6 +20,8 @@
 #include <thread>
 #include <future>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <shared_mutex>
 #include <atomic>
 #include <unordered_map>
@@ -31,8 +33,13 @@
 #include <filesystem>
 #include <cwctype>
 #include <cmath>
+#include <climits>
 #include <cstring>
 #include <deque>
+#include <list>
+#include <map>
+#include <bit>
+#include <array>
 
 #ifdef _WIN64
 #include <immintrin.h>
@@ -53,14 +60,13 @@
 #endif
 
 #define MAX_MATCHES 1024
-#define MAX_CACHED_BITMAPS 100
-#define MAX_CACHED_LOCATIONS 100
 #define CACHE_MISS_THRESHOLD 3
 #define MUTEX_RETRY_COUNT 3
 #define MUTEX_RETRY_BASE_MS 100
 #define MAX_RESULT_STRING_LENGTH 262144
 
 static std::atomic<int> g_pixel_pool_size{ 50 };
+static std::atomic<bool> g_non_overlapping_matches{ false };  // ImageSearch_SetOption(L"NonOverlapping", 1)
 
 using namespace Gdiplus;
 
@@ -309,20 +315,260 @@ inline std::wstring FormatError(ErrorCode code) {
 	return L"{" + std::to_wstring(static_cast<int>(code)) + L"}[]<" + GetErrorMessage(code) + L">";
 }
 
+// ============================================================================
+// CONTENT HASH: 128-bit template identity
+// ============================================================================
+// Description:
+//   Hashes a bitmap's dimensions and every pixel into a 128-bit ContentId.
+//   Derived-artifact caches key on it, so two different templates of the
+//   same size can no longer share a cached scaled copy.
+//
+// Algorithm:
+//   - XXH3-style accumulation: 64-byte stripes feed eight 64-bit lanes,
+//     acc[i] += lo32(d ^ k[i]) * hi32(d ^ k[i]) and acc[i ^ 1] += d, with
+//     one _mm_mul_epu32 per lane pair (SSE2: 2 lanes, AVX2: 4, AVX-512: 8)
+//   - Every 16 stripes (1 KB) the lanes are scrambled with a shift, xor
+//     and multiply so that stripe order matters
+//   - The tail is zero-padded to a stripe; byte length and dimensions are
+//     folded into the final mix, which avalanches both 64-bit halves
+//
+// Notes:
+//   All backends produce identical IDs. The ID is computed at most once per
+//   pixel storage (see PixelStorage::GetContentId) and shared by every
+//   buffer over the same pixels.
+// ============================================================================
+struct ContentId {
+	uint64_t lo = 0;
+	uint64_t hi = 0;
+
+	bool operator==(const ContentId& other) const { return lo == other.lo && hi == other.hi; }
+	bool operator!=(const ContentId& other) const { return !(*this == other); }
+};
+
+namespace ContentHash {
+	constexpr int kLanes = 8;
+	constexpr int kStripeBytes = kLanes * 8;
+	constexpr size_t kStripesPerBlock = 16;
+	constexpr uint64_t kPrime32 = 0x9E3779B1ULL;
+	constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+	alignas(64) constexpr uint64_t kSecret[kLanes] = {
+		0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+		0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+	};
+
+	inline uint64_t Avalanche(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	inline void Accumulate_Scalar(uint64_t* acc, const uint8_t* data, size_t stripes) {
+		for (size_t s = 0; s < stripes; ++s, data += kStripeBytes) {
+			for (int i = 0; i < kLanes; ++i) {
+				uint64_t d;
+				std::memcpy(&d, data + i * 8, sizeof(d));
+				const uint64_t dk = d ^ kSecret[i];
+				acc[i ^ 1] += d;
+				acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+			}
+		}
+	}
+
+	// SSE2 is baseline on x64, so this serves both builds
+	inline void Accumulate_SSE2(uint64_t* acc, const uint8_t* data, size_t stripes) {
+		__m128i a[4], k[4];
+		for (int j = 0; j < 4; ++j) {
+			a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + j * 2));
+			k[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(kSecret + j * 2));
+		}
+		for (size_t s = 0; s < stripes; ++s, data += kStripeBytes) {
+			for (int j = 0; j < 4; ++j) {
+				const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j * 16));
+				const __m128i dk = _mm_xor_si128(d, k[j]);
+				const __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+				a[j] = _mm_add_epi64(a[j], _mm_add_epi64(product, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+			}
+		}
+		for (int j = 0; j < 4; ++j) _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + j * 2), a[j]);
+	}
+
+#ifdef _WIN64
+	inline void Accumulate_AVX2(uint64_t* acc, const uint8_t* data, size_t stripes) {
+		__m256i a[2], k[2];
+		for (int j = 0; j < 2; ++j) {
+			a[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + j * 4));
+			k[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(kSecret + j * 4));
+		}
+		for (size_t s = 0; s < stripes; ++s, data += kStripeBytes) {
+			for (int j = 0; j < 2; ++j) {
+				const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j * 32));
+				const __m256i dk = _mm256_xor_si256(d, k[j]);
+				const __m256i product = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+				a[j] = _mm256_add_epi64(a[j], _mm256_add_epi64(product, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+			}
+		}
+		for (int j = 0; j < 2; ++j) _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + j * 4), a[j]);
+	}
+
+	inline void Accumulate_AVX512(uint64_t* acc, const uint8_t* data, size_t stripes) {
+		__m512i a = _mm512_loadu_si512(acc);
+		const __m512i k = _mm512_load_si512(kSecret);
+		for (size_t s = 0; s < stripes; ++s, data += kStripeBytes) {
+			const __m512i d = _mm512_loadu_si512(data);
+			const __m512i dk = _mm512_xor_si512(d, k);
+			const __m512i product = _mm512_mul_epu32(dk, _mm512_srli_epi64(dk, 32));
+			a = _mm512_add_epi64(a, _mm512_add_epi64(product, _mm512_shuffle_epi32(d, _MM_PERM_BADC)));
+		}
+		_mm512_storeu_si512(acc, a);
+	}
+#endif
+
+	inline ContentId Compute(const COLORREF* pixels, size_t count, int width, int height) {
+		void (*accumulate)(uint64_t*, const uint8_t*, size_t) = Accumulate_Scalar;
+#ifdef _WIN64
+		accumulate = g_is_avx512_supported.load(std::memory_order_relaxed) ? Accumulate_AVX512
+			: g_is_avx2_supported.load(std::memory_order_relaxed) ? Accumulate_AVX2 : Accumulate_SSE2;
+#else
+		if (g_is_sse2_supported.load(std::memory_order_relaxed)) accumulate = Accumulate_SSE2;
+#endif
+
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(pixels);
+		const size_t bytes = count * sizeof(COLORREF);
+		size_t stripes = bytes / kStripeBytes;
+
+		uint64_t acc[kLanes];
+		for (int i = 0; i < kLanes; ++i) acc[i] = kSecret[i] ^ kPrime64_2;
+
+		while (stripes > 0) {
+			const size_t run = std::min(stripes, kStripesPerBlock);
+			accumulate(acc, data, run);
+			data += run * kStripeBytes;
+			stripes -= run;
+			for (int i = 0; i < kLanes; ++i) {
+				acc[i] ^= acc[i] >> 47;
+				acc[i] ^= kSecret[i];
+				acc[i] *= kPrime32;
+			}
+		}
+
+		const size_t tail = bytes % kStripeBytes;
+		if (tail > 0) {
+			alignas(64) uint8_t last[kStripeBytes] = {};
+			std::memcpy(last, data, tail);
+			accumulate(acc, last, 1);
+		}
+
+		uint64_t lo = (bytes * kPrime64_1) ^ ((static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32) | static_cast<uint32_t>(height));
+		uint64_t hi = lo ^ kPrime64_2;
+		for (int i = 0; i < kLanes; ++i) {
+			lo = (lo ^ acc[i]) * kPrime64_1;
+			lo ^= lo >> 29;
+			hi = (hi + acc[i]) * kPrime64_2;
+			hi ^= hi >> 31;
+		}
+		return { Avalanche(lo), Avalanche(hi ^ (lo >> 1)) };
+	}
+}
+
 struct PixelBufferPool;
 extern PixelBufferPool g_pixel_pool;
 
+// Reference-counted pixel array with the std::vector calls PixelBuffer users
+// need. Copies share the same pixels, so cached bitmaps are handed out
+// without copying; pixels are only written while a buffer is being filled,
+// before it is shared.
+class PixelStorage {
+public:
+	PixelStorage() = default;
+	PixelStorage(std::vector<COLORREF>&& pixels) : m_block(std::make_shared<Block>(std::move(pixels))) {}
+
+	PixelStorage& operator=(std::vector<COLORREF>&& pixels) {
+		m_block = std::make_shared<Block>(std::move(pixels));
+		return *this;
+	}
+
+	size_t size() const { return m_block ? m_block->pixels.size() : 0; }
+	size_t capacity() const { return m_block ? m_block->pixels.capacity() : 0; }
+	bool empty() const { return size() == 0; }
+	COLORREF* data() { return m_block ? m_block->pixels.data() : nullptr; }
+	const COLORREF* data() const { return m_block ? m_block->pixels.data() : nullptr; }
+	COLORREF& operator[](size_t i) { return m_block->pixels[i]; }
+	const COLORREF& operator[](size_t i) const { return m_block->pixels[i]; }
+
+	void resize(size_t count) {
+		if (!m_block) m_block = std::make_shared<Block>(std::vector<COLORREF>());
+		m_block->pixels.resize(count);
+	}
+
+	void clear() { m_block.reset(); }
+
+	// True when no other PixelStorage shares these pixels
+	bool IsUnique() const { return m_block && m_block.use_count() == 1; }
+
+	// Moves the pixels out (for the pool); the storage becomes empty
+	std::vector<COLORREF> Take() {
+		std::vector<COLORREF> pixels = std::move(m_block->pixels);
+		m_block.reset();
+		return pixels;
+	}
+
+	// Content hash of the pixels, computed on first use and kept with them
+	ContentId GetContentId(int width, int height) const {
+		if (!m_block) return {};
+		Block& block = *m_block;
+		if (!block.hashed.load(std::memory_order_acquire)) {
+			const ContentId id = ContentHash::Compute(block.pixels.data(), block.pixels.size(), width, height);
+			block.hash_lo.store(id.lo, std::memory_order_relaxed);
+			block.hash_hi.store(id.hi, std::memory_order_relaxed);
+			block.hashed.store(true, std::memory_order_release);
+		}
+		return { block.hash_lo.load(std::memory_order_relaxed), block.hash_hi.load(std::memory_order_relaxed) };
+	}
+
+private:
+	struct Block {
+		explicit Block(std::vector<COLORREF>&& p) : pixels(std::move(p)) {}
+
+		std::vector<COLORREF> pixels;
+		std::atomic<bool> hashed{ false };  // racing first hashes store the same ID
+		std::atomic<uint64_t> hash_lo{ 0 };
+		std::atomic<uint64_t> hash_hi{ 0 };
+	};
+
+	std::shared_ptr<Block> m_block;
+};
+
 struct PixelBuffer {
-	std::vector<COLORREF> pixels;
+	PixelStorage pixels;
 	int width = 0;
 	int height = 0;
 	bool has_alpha = false;
-	bool owns_memory = true;
+	bool owns_memory = true;  // return the pixels to g_pixel_pool when the last reference goes
 
 	bool IsValid() const {
 		return width > 0 && height > 0 && pixels.size() == static_cast<size_t>(width * height);
 	}
 
+	// Identity of the pixel content; keys derived-artifact caches
+	ContentId GetContentId() const {
+		return pixels.GetContentId(width, height);
+	}
+
+	// Another buffer over the same pixels, without copying them
+	PixelBuffer Share() const {
+		PixelBuffer view;
+		view.pixels = pixels;
+		view.width = width;
+		view.height = height;
+		view.has_alpha = has_alpha;
+		view.owns_memory = false;
+		return view;
+	}
+
 	~PixelBuffer();
 
 	PixelBuffer() = default;
@@ -349,64 +595,290 @@ struct CacheEntry {
 };
 
 // ============================================================================
-// CACHE SYSTEM - Global Variables
+// SHARDED LRU CACHE
 // ============================================================================
 // Description:
-//   Two-tier caching system for image search results:
-//   1. In-memory LRU cache (fast, volatile)
-//   2. Persistent disk cache (survives DLL reload, slower)
-//
-// Cache Key Format:
-//   "normalized_path|tolerance|transparent|scale"
-//   Example: "c:\images\icon.png|10|1|1.0"
+//   Fixed-capacity LRU map with O(1) lookup, insert, touch and eviction.
+//   Each shard keeps its entries in a std::list (most recent first) and a
+//   hash map from key to list node; hits splice the node to the front, so
+//   no index is ever rebuilt. Keys are spread over shards by hash and
+//   every shard has its own mutex, so concurrent searches only contend
+//   when they touch the same shard.
 //
-// Cache Validation:
-//   - Each cache entry tracks miss count
-//   - After 3 consecutive misses, entry is invalidated and removed
-//   - Prevents stale cache from causing false negatives
+// Notes:
+//   - The capacity is split evenly across shards (rounded up); recency is
+//     exact within a shard and approximate across the whole cache
+//   - SetCapacity() can be called at any time and trims shards that are
+//     over the new limit
 // ============================================================================
-std::deque<std::pair<std::wstring, CacheEntry>> g_location_cache_lru;  // LRU queue: most recent first
-std::unordered_map<std::wstring, size_t> g_location_cache_index;       // Fast lookup: key -> index in LRU
-std::shared_mutex g_cache_mutex;                                       // Thread-safe access to cache
-std::wstring g_cache_base_dir;                                        // Base directory for disk cache files
-HANDLE g_hCacheFileMutex = nullptr;                                   // System-wide mutex for file cache
+#define CACHE_SHARD_COUNT 8
+#define DEFAULT_CACHED_LOCATIONS 100
 
-// ============================================================================
-// HELPER: _RebuildCacheIndex
-// ============================================================================
-// Description:
-//   Rebuilds the hash map index after LRU queue modifications.
-//   Called after insertions, deletions, or reordering of cache entries.
-// ============================================================================
-void _RebuildCacheIndex() {
-	g_location_cache_index.clear();
-	for (size_t i = 0; i < g_location_cache_lru.size(); ++i) {
-		g_location_cache_index[g_location_cache_lru[i].first] = i;
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+public:
+	explicit ShardedLruCache(size_t capacity) {
+		SetCapacity(capacity);
+	}
+
+	std::optional<Value> Get(const Key& key) {
+		Shard& shard = ShardFor(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.index.find(key);
+		if (it == shard.index.end()) return std::nullopt;
+		shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+		return it->second->second;
+	}
+
+	void Put(const Key& key, Value value) {
+		Shard& shard = ShardFor(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.index.find(key);
+		if (it != shard.index.end()) {
+			it->second->second = std::move(value);
+			shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+			return;
+		}
+		shard.entries.emplace_front(key, std::move(value));
+		shard.index.emplace(key, shard.entries.begin());
+		Trim(shard, m_shard_capacity.load(std::memory_order_relaxed));
 	}
-}
+
+	void Erase(const Key& key) {
+		Shard& shard = ShardFor(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.index.find(key);
+		if (it == shard.index.end()) return;
+		shard.entries.erase(it->second);
+		shard.index.erase(it);
+	}
+
+	void Clear() {
+		for (Shard& shard : m_shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.entries.clear();
+			shard.index.clear();
+		}
+	}
+
+	void SetCapacity(size_t capacity) {
+		const size_t per_shard = (std::max<size_t>(capacity, 1) + CACHE_SHARD_COUNT - 1) / CACHE_SHARD_COUNT;
+		m_capacity.store(capacity, std::memory_order_relaxed);
+		m_shard_capacity.store(per_shard, std::memory_order_relaxed);
+		for (Shard& shard : m_shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			Trim(shard, per_shard);
+		}
+	}
+
+	size_t Capacity() const {
+		return m_capacity.load(std::memory_order_relaxed);
+	}
+
+	size_t Size() {
+		size_t total = 0;
+		for (Shard& shard : m_shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			total += shard.index.size();
+		}
+		return total;
+	}
+
+private:
+	using EntryList = std::list<std::pair<Key, Value>>;
+
+	struct Shard {
+		std::mutex mutex;
+		EntryList entries;
+		std::unordered_map<Key, typename EntryList::iterator, Hash> index;
+	};
+
+	Shard& ShardFor(const Key& key) {
+		size_t h = Hash{}(key);
+		h ^= h >> 17;  // the low bits also pick the bucket inside the shard
+		return m_shards[h % CACHE_SHARD_COUNT];
+	}
+
+	static void Trim(Shard& shard, size_t limit) {
+		while (shard.index.size() > limit) {
+			shard.index.erase(shard.entries.back().first);
+			shard.entries.pop_back();
+		}
+	}
+
+	std::array<Shard, CACHE_SHARD_COUNT> m_shards;
+	std::atomic<size_t> m_capacity{ 0 };
+	std::atomic<size_t> m_shard_capacity{ 1 };
+};
 
 // ============================================================================
-// HELPER: GetCacheBaseDir
+// BYTE-BUDGETED BITMAP CACHE (GDSF)
 // ============================================================================
 // Description:
-//   Returns the base directory for persistent disk cache files.
-//   Uses system temp directory and creates it if needed.
+//   Keeps decoded and scaled bitmaps resident up to a byte budget instead
+//   of an entry count, so a few large InImage sources cannot push out
+//   hundreds of small templates. Eviction follows Greedy-Dual-Size-
+//   Frequency: every entry has priority L + hits / bytes, the entry with
+//   the lowest priority is evicted first, and L is raised to each evicted
+//   priority so long-idle entries age out.
+//
+// Notes:
+//   - Sharded like ShardedLruCache (per-shard mutex, map + priority index).
+//     L and the resident byte count are global, so priorities compare
+//     across shards; eviction picks the lowest head over all shards
+//   - An entry larger than the whole budget is not cached; a new entry
+//     that is itself the lowest priority is evicted right away, so large
+//     one-off sources do not displace small, frequently used templates
 // ============================================================================
-std::wstring GetCacheBaseDir() {
-	if (!g_cache_base_dir.empty()) return g_cache_base_dir;
+#ifdef _WIN64
+#define DEFAULT_BITMAP_CACHE_MB 256
+#else
+#define DEFAULT_BITMAP_CACHE_MB 64
+#endif
 
-	wchar_t temp_path[MAX_PATH];
-	DWORD path_len = GetTempPathW(MAX_PATH, temp_path);
-	if (path_len > 0 && path_len < MAX_PATH) {
-		g_cache_base_dir = temp_path;
-		try {
-			std::filesystem::create_directories(g_cache_base_dir);
+struct CacheStats {
+	uint64_t resident_bytes = 0;
+	uint64_t budget_bytes = 0;
+	uint64_t entries = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+};
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class GdsfCache {
+public:
+	explicit GdsfCache(size_t budget_bytes) : m_budget(budget_bytes) {}
+
+	std::optional<Value> Get(const Key& key) {
+		Shard& shard = ShardFor(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.index.find(key);
+		if (it == shard.index.end()) {
+			m_misses.fetch_add(1, std::memory_order_relaxed);
+			return std::nullopt;
 		}
-		catch (...) {}
-		return g_cache_base_dir;
+		m_hits.fetch_add(1, std::memory_order_relaxed);
+		Node& node = it->second;
+		++node.frequency;
+		shard.queue.erase(node.slot);
+		node.slot = shard.queue.emplace(Priority(node), &it->first);
+		return node.value;
+	}
+
+	void Put(const Key& key, Value value, size_t bytes) {
+		Shard& shard = ShardFor(key);
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			uint32_t frequency = 1;
+			auto it = shard.index.find(key);
+			if (it != shard.index.end()) {
+				frequency = it->second.frequency;
+				shard.queue.erase(it->second.slot);
+				m_resident.fetch_sub(it->second.bytes, std::memory_order_relaxed);
+				shard.index.erase(it);
+			}
+			if (bytes > m_budget.load(std::memory_order_relaxed)) return;
+
+			it = shard.index.emplace(key, Node{ std::move(value), bytes, frequency }).first;
+			it->second.slot = shard.queue.emplace(Priority(it->second), &it->first);
+			m_resident.fetch_add(bytes, std::memory_order_relaxed);
+		}
+		Enforce();
 	}
-	return L"";
-}
+
+	void Clear() {
+		for (Shard& shard : m_shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (const auto& [key, node] : shard.index) m_resident.fetch_sub(node.bytes, std::memory_order_relaxed);
+			shard.queue.clear();
+			shard.index.clear();
+		}
+	}
+
+	void SetBudget(size_t budget_bytes) {
+		m_budget.store(budget_bytes, std::memory_order_relaxed);
+		Enforce();
+	}
+
+	CacheStats GetStats() {
+		CacheStats stats;
+		for (Shard& shard : m_shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			stats.entries += shard.index.size();
+		}
+		stats.resident_bytes = m_resident.load(std::memory_order_relaxed);
+		stats.budget_bytes = m_budget.load(std::memory_order_relaxed);
+		stats.hits = m_hits.load(std::memory_order_relaxed);
+		stats.misses = m_misses.load(std::memory_order_relaxed);
+		stats.evictions = m_evictions.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	using PriorityQueue = std::multimap<double, const Key*>;
+
+	struct Node {
+		Value value;
+		size_t bytes = 0;
+		uint32_t frequency = 1;
+		typename PriorityQueue::iterator slot;
+	};
+
+	struct Shard {
+		std::mutex mutex;
+		std::unordered_map<Key, Node, Hash> index;  // node-based: key addresses stay valid
+		PriorityQueue queue;                        // lowest priority first
+	};
+
+	Shard& ShardFor(const Key& key) {
+		size_t h = Hash{}(key);
+		h ^= h >> 17;  // the low bits also pick the bucket inside the shard
+		return m_shards[h % CACHE_SHARD_COUNT];
+	}
+
+	double Priority(const Node& node) const {
+		return m_inflation.load(std::memory_order_relaxed) + static_cast<double>(node.frequency) / std::max<size_t>(node.bytes, 1);
+	}
+
+	// Evicts lowest-priority entries over all shards until within budget
+	void Enforce() {
+		while (m_resident.load(std::memory_order_relaxed) > m_budget.load(std::memory_order_relaxed)) {
+			Shard* victim = nullptr;
+			double lowest = 0.0;
+			for (Shard& shard : m_shards) {
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				if (shard.queue.empty()) continue;
+				auto head = shard.queue.begin();
+				if (!victim || head->first < lowest) {
+					victim = &shard;
+					lowest = head->first;
+				}
+			}
+			if (!victim) return;
+
+			std::lock_guard<std::mutex> lock(victim->mutex);
+			if (victim->queue.empty()) continue;
+			auto head = victim->queue.begin();
+
+			double inflation = m_inflation.load(std::memory_order_relaxed);
+			while (head->first > inflation && !m_inflation.compare_exchange_weak(inflation, head->first, std::memory_order_relaxed)) {}
+			auto it = victim->index.find(*head->second);
+			m_resident.fetch_sub(it->second.bytes, std::memory_order_relaxed);
+			victim->queue.erase(head);
+			victim->index.erase(it);
+			m_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	std::array<Shard, CACHE_SHARD_COUNT> m_shards;
+	std::atomic<size_t> m_budget;
+	std::atomic<size_t> m_resident{ 0 };
+	std::atomic<double> m_inflation{ 0.0 };
+	std::atomic<uint64_t> m_hits{ 0 };
+	std::atomic<uint64_t> m_misses{ 0 };
+	std::atomic<uint64_t> m_evictions{ 0 };
+};
 
 // ============================================================================
 // HELPER: GetNormalizedPathKey
@@ -440,43 +912,249 @@ std::wstring GetNormalizedPathKey(const std::wstring& path_str) {
 }
 
 // ============================================================================
-// HELPER: GenerateCacheKey
+// CACHE KEYS: Interned paths and typed keys
+// ============================================================================
+// Description:
+//   Cache lookups run on every search, so keys are small PODs compared
+//   field by field instead of strings assembled per call.
+//
+// Components:
+//   - PathInterner: maps each path to a 32-bit ID. The filesystem
+//     normalization (GetNormalizedPathKey) runs only the first time a
+//     path is seen; spellings of the same file share one ID.
+//   - LocationKey: search parameters for the location cache
+//   - BitmapKey: decoded file or scaled content for the bitmap cache
+//
+// Notes:
+//   Both keys carry a hash computed once at construction. LocationKey's
+//   hash is built from FNV-1a hashes of the normalized paths, not from
+//   the IDs, so it is stable across processes and names the disk cache
+//   file. IDs are never reused: when the interner reaches
+//   PATH_INTERN_LIMIT it starts over, and keys made before that simply
+//   stop matching.
+// ============================================================================
+#define PATH_INTERN_LIMIT 4096
+
+namespace CacheKeyHash {
+	inline uint64_t Combine(uint64_t seed, uint64_t value) {
+		return ContentHash::Avalanche(seed ^ (value + ContentHash::kPrime64_1 + (seed << 6) + (seed >> 2)));
+	}
+
+	// FNV-1a over UTF-16 code units; identical in every process
+	inline uint64_t Path(const std::wstring& normalized) {
+		uint64_t h = 0xCBF29CE484222325ULL;
+		for (wchar_t c : normalized) {
+			h ^= static_cast<uint16_t>(c);
+			h *= 0x100000001B3ULL;
+		}
+		return h;
+	}
+}
+
+struct InternedPath {
+	uint32_t id = 0;               // 0 = no path
+	uint64_t stable_hash = 0;      // CacheKeyHash::Path of the normalized path
+};
+
+class PathInterner {
+public:
+	InternedPath Intern(const std::wstring& path) {
+		if (path.empty()) return {};
+
+		// Relative paths resolve against the current directory, which may change
+		std::wstring lookup = path;
+		try {
+			std::filesystem::path p(path);
+			if (!p.is_absolute()) lookup = std::filesystem::absolute(p).wstring();
+		}
+		catch (...) {}
+
+		{
+			std::shared_lock<std::shared_mutex> lock(m_mutex);
+			auto it = m_by_raw.find(lookup);
+			if (it != m_by_raw.end()) return it->second;
+		}
+
+		std::wstring normalized = GetNormalizedPathKey(path);
+
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		if (m_by_raw.size() >= PATH_INTERN_LIMIT) {
+			m_by_raw.clear();
+			m_by_normalized.clear();
+		}
+		auto it = m_by_normalized.find(normalized);
+		if (it == m_by_normalized.end()) {
+			const InternedPath entry{ m_next_id++, CacheKeyHash::Path(normalized) };
+			it = m_by_normalized.emplace(std::move(normalized), entry).first;
+		}
+		m_by_raw.emplace(std::move(lookup), it->second);
+		return it->second;
+	}
+
+private:
+	std::shared_mutex m_mutex;
+	std::unordered_map<std::wstring, InternedPath> m_by_raw;
+	std::unordered_map<std::wstring, InternedPath> m_by_normalized;
+	uint32_t m_next_id = 1;
+};
+
+PathInterner g_path_interner;
+
+struct LocationKey {
+	uint32_t primary = 0;          // Interned source path ID
+	uint32_t secondary = 0;        // Interned target path ID, 0 if none
+	int32_t tolerance = 0;
+	int32_t scale_milli = 1000;    // Scale in thousandths
+	bool transparent = false;
+	uint64_t hash = 0;
+
+	bool IsValid() const { return primary != 0; }
+
+	bool operator==(const LocationKey& other) const {
+		return primary == other.primary && secondary == other.secondary && tolerance == other.tolerance
+			&& scale_milli == other.scale_milli && transparent == other.transparent;
+	}
+};
+
+struct LocationKeyHash {
+	size_t operator()(const LocationKey& key) const { return static_cast<size_t>(key.hash); }
+};
+
+enum class BitmapKind : uint8_t {
+	Decoded,        // GDI+ decode of a file
+	NativeDecoded,  // Built-in decoder output for a file
+	Scaled          // Resampled pixels of some source content
+};
+
+struct BitmapKey {
+	BitmapKind kind = BitmapKind::Decoded;
+	uint32_t path = 0;             // Decoded kinds: interned file path ID
+	ContentId source;              // Scaled: content of the source pixels
+	int32_t width = 0;             // Scaled: target size and filter
+	int32_t height = 0;
+	int32_t filter = 0;
+	uint64_t hash = 0;
+
+	static BitmapKey ForFile(BitmapKind kind, const std::wstring& file_path) {
+		BitmapKey key;
+		key.kind = kind;
+		key.path = g_path_interner.Intern(file_path).id;
+		key.hash = CacheKeyHash::Combine(static_cast<uint64_t>(kind), key.path);
+		return key;
+	}
+
+	static BitmapKey ForScaled(const ContentId& source, int width, int height, int filter) {
+		BitmapKey key;
+		key.kind = BitmapKind::Scaled;
+		key.source = source;
+		key.width = width;
+		key.height = height;
+		key.filter = filter;
+		uint64_t h = CacheKeyHash::Combine(static_cast<uint64_t>(BitmapKind::Scaled), source.lo);
+		h = CacheKeyHash::Combine(h, source.hi);
+		h = CacheKeyHash::Combine(h, (static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32) | static_cast<uint32_t>(height));
+		key.hash = CacheKeyHash::Combine(h, static_cast<uint64_t>(filter));
+		return key;
+	}
+
+	bool operator==(const BitmapKey& other) const {
+		return kind == other.kind && path == other.path && source == other.source
+			&& width == other.width && height == other.height && filter == other.filter;
+	}
+};
+
+struct BitmapKeyHash {
+	size_t operator()(const BitmapKey& key) const { return static_cast<size_t>(key.hash); }
+};
+
+// ============================================================================
+// CACHE SYSTEM - Global Variables
 // ============================================================================
 // Description:
-//   Generates a unique cache key from search parameters.
-//   Two searches with identical parameters will produce identical keys,
-//   ensuring cache hits for repeated searches.
+//   Two-tier caching system for image search results:
+//   1. In-memory LRU cache (fast, volatile)
+//   2. Persistent disk cache (survives DLL reload, slower)
 //
-// Format:
-//   "normalized_primary_path|normalized_secondary_path|tolerance|transparent|scale"
+// Cache Key Format:
+//   LocationKey {source path ID, target path ID, tolerance, transparent,
+//   scale}; see CACHE KEYS. The disk file for a key is
+//   "~CACHE_IMGSEARCH_V3_<16 hex digits of the key hash>.dat".
+//
+// Cache Validation:
+//   - Each cache entry tracks miss count
+//   - After 3 consecutive misses, entry is invalidated and removed
+//   - Prevents stale cache from causing false negatives
+//
+// Capacity:
+//   ImageSearch_SetOption(L"LocationCacheSize", n), default 100 entries
+// ============================================================================
+ShardedLruCache<LocationKey, CacheEntry, LocationKeyHash> g_location_cache(DEFAULT_CACHED_LOCATIONS);  // In-memory LRU tier
+std::wstring g_cache_base_dir;                                        // Base directory for disk cache files
+HANDLE g_hCacheFileMutex = nullptr;                                   // System-wide mutex for file cache
+
+// ============================================================================
+// HELPER: GetCacheBaseDir
+// ============================================================================
+// Description:
+//   Returns the base directory for persistent disk cache files.
+//   Uses system temp directory and creates it if needed.
+// ============================================================================
+std::wstring GetCacheBaseDir() {
+	if (!g_cache_base_dir.empty()) return g_cache_base_dir;
+
+	wchar_t temp_path[MAX_PATH];
+	DWORD path_len = GetTempPathW(MAX_PATH, temp_path);
+	if (path_len > 0 && path_len < MAX_PATH) {
+		g_cache_base_dir = temp_path;
+		try {
+			std::filesystem::create_directories(g_cache_base_dir);
+		}
+		catch (...) {}
+		return g_cache_base_dir;
+	}
+	return L"";
+}
+
+// ============================================================================
+// HELPER: GenerateCacheKey
+// ============================================================================
+// Description:
+//   Builds the location cache key for a search. Two searches with
+//   identical parameters produce equal keys, ensuring cache hits for
+//   repeated searches. Paths are interned, so only the first search for
+//   a path pays for normalization.
 //
 // Example:
 //   GenerateCacheKey("C:\screen.png", "icon.png", 10, true, 1.0)
-//   -> "c:\screen.png|c:\icon.png|10|1|1.0"
+//   -> { id("c:\screen.png"), id("c:\icon.png"), 10, 1000, true }
 // ============================================================================
-std::wstring GenerateCacheKey(const std::wstring& primary_path, const std::wstring& secondary_path = L"",
+LocationKey GenerateCacheKey(const std::wstring& primary_path, const std::wstring& secondary_path = L"",
 	int tolerance = 0, bool transparent = false, float scale = 1.0f) {
-	std::wstring normalized_primary = GetNormalizedPathKey(primary_path);
-	std::wstringstream ss;
-	ss << normalized_primary;
-	if (!secondary_path.empty()) {
-		std::wstring normalized_secondary = GetNormalizedPathKey(secondary_path);
-		ss << L"|" << normalized_secondary;
-	}
-	ss << L"|" << tolerance << L"|" << transparent << L"|" << std::fixed << std::setprecision(1) << scale;
-	return ss.str();
+	const InternedPath primary = g_path_interner.Intern(primary_path);
+	const InternedPath secondary = g_path_interner.Intern(secondary_path);
+
+	LocationKey key;
+	key.primary = primary.id;
+	key.secondary = secondary.id;
+	key.tolerance = tolerance;
+	key.scale_milli = static_cast<int32_t>(std::lround(scale * 1000.0f));
+	key.transparent = transparent;
+
+	uint64_t h = CacheKeyHash::Combine(primary.stable_hash, secondary.stable_hash);
+	h = CacheKeyHash::Combine(h, (static_cast<uint64_t>(static_cast<uint32_t>(tolerance)) << 32) | static_cast<uint32_t>(key.scale_milli));
+	key.hash = CacheKeyHash::Combine(h, transparent ? 1 : 0);
+	return key;
 }
 
-std::wstring GetCacheFileForImage(const std::wstring& cache_key) {
-	std::size_t hasher = std::hash<std::wstring>{}(cache_key);
-	std::wstringstream ss;
-	ss << L"~CACHE_IMGSEARCH_V2_" << std::hex << std::uppercase << hasher << L".dat";
-	std::filesystem::path file_path = std::filesystem::path(GetCacheBaseDir()) / ss.str();
+std::wstring GetCacheFileForImage(const LocationKey& cache_key) {
+	wchar_t file_name[64];
+	swprintf_s(file_name, _countof(file_name), L"~CACHE_IMGSEARCH_V3_%016llX.dat", static_cast<unsigned long long>(cache_key.hash));
+	std::filesystem::path file_path = std::filesystem::path(GetCacheBaseDir()) / file_name;
 	return file_path.wstring();
 }
 
-void LoadCacheForImage(const std::wstring& cache_key) {
-	if (cache_key.empty()) return;
+void LoadCacheForImage(const LocationKey& cache_key) {
+	if (!cache_key.IsValid()) return;
 
 	if (!g_hCacheFileMutex) return;
 
@@ -504,14 +1182,7 @@ void LoadCacheForImage(const std::wstring& cache_key) {
 						entry.miss_count = 0;
 						entry.last_used = std::chrono::steady_clock::now();
 
-						std::unique_lock lock(g_cache_mutex);
-						g_location_cache_lru.push_front({ cache_key, entry });
-
-						while (g_location_cache_lru.size() > MAX_CACHED_LOCATIONS) {
-							g_location_cache_lru.pop_back();
-						}
-
-						_RebuildCacheIndex();
+						g_location_cache.Put(cache_key, entry);
 					}
 				}
 				catch (const std::exception&) {
@@ -523,8 +1194,8 @@ void LoadCacheForImage(const std::wstring& cache_key) {
 	}
 }
 
-void SaveCacheForImage(const std::wstring& cache_key, POINT pos) {
-	if (cache_key.empty()) return;
+void SaveCacheForImage(const LocationKey& cache_key, POINT pos) {
+	if (!cache_key.IsValid()) return;
 
 	if (!g_hCacheFileMutex) return;
 
@@ -542,20 +1213,10 @@ void SaveCacheForImage(const std::wstring& cache_key, POINT pos) {
 	catch (...) {}
 }
 
-void RemoveFromCache(const std::wstring& cache_key) {
-	if (cache_key.empty()) return;
+void RemoveFromCache(const LocationKey& cache_key) {
+	if (!cache_key.IsValid()) return;
 
-	{
-		std::unique_lock lock(g_cache_mutex);
-		auto it = g_location_cache_index.find(cache_key);
-		if (it != g_location_cache_index.end()) {
-			size_t idx = it->second;
-			if (idx < g_location_cache_lru.size()) {
-				g_location_cache_lru.erase(g_location_cache_lru.begin() + idx);
-				_RebuildCacheIndex();
-			}
-		}
-	}
+	g_location_cache.Erase(cache_key);
 
 	try {
 		std::wstring cache_file_path = GetCacheFileForImage(cache_key);
@@ -564,109 +1225,27 @@ void RemoveFromCache(const std::wstring& cache_key) {
 	catch (...) {}
 }
 
-std::optional<CacheEntry> GetCachedLocation(const std::wstring& cache_key) {
-	std::unique_lock lock(g_cache_mutex);
-	auto it = g_location_cache_index.find(cache_key);
-	if (it != g_location_cache_index.end()) {
-		size_t idx = it->second;
-
-		if (idx >= g_location_cache_lru.size()) {
-			_RebuildCacheIndex();
-			it = g_location_cache_index.find(cache_key);
-			if (it == g_location_cache_index.end()) return std::nullopt;
-			idx = it->second;
-		}
+std::optional<CacheEntry> GetCachedLocation(const LocationKey& cache_key) {
+	auto entry = g_location_cache.Get(cache_key);
+	if (entry) entry->last_used = std::chrono::steady_clock::now();
+	return entry;
+}
 
-		auto entry = g_location_cache_lru[idx].second;
-		entry.last_used = std::chrono::steady_clock::now();
+void UpdateCachedLocation(const LocationKey& cache_key, const CacheEntry& entry) {
+	g_location_cache.Put(cache_key, entry);
+}
 
-		if (idx > 0) {
-			auto item = g_location_cache_lru[idx];
-			g_location_cache_lru.erase(g_location_cache_lru.begin() + idx);
-			g_location_cache_lru.push_front(item);
-			_RebuildCacheIndex();
-		}
+// Decoded and scaled bitmaps; ImageSearch_SetOption(L"BitmapCacheMB", n)
+GdsfCache<BitmapKey, std::shared_ptr<PixelBuffer>, BitmapKeyHash> g_bitmap_cache(static_cast<size_t>(DEFAULT_BITMAP_CACHE_MB) << 20);
 
-		return entry;
-	}
-	return std::nullopt;
+std::shared_ptr<PixelBuffer> GetCachedBitmap(const BitmapKey& key) {
+	return g_bitmap_cache.Get(key).value_or(nullptr);
 }
 
-void UpdateCachedLocation(const std::wstring& cache_key, const CacheEntry& entry) {
-	std::unique_lock lock(g_cache_mutex);
-
-	auto it = g_location_cache_index.find(cache_key);
-	if (it != g_location_cache_index.end()) {
-		size_t idx = it->second;
-		g_location_cache_lru[idx].second = entry;
-
-		if (idx > 0) {
-			auto item = g_location_cache_lru[idx];
-			g_location_cache_lru.erase(g_location_cache_lru.begin() + idx);
-			g_location_cache_lru.push_front(item);
-			_RebuildCacheIndex();
-		}
-	}
-	else {
-		g_location_cache_lru.push_front({ cache_key, entry });
-
-		while (g_location_cache_lru.size() > MAX_CACHED_LOCATIONS) {
-			g_location_cache_lru.pop_back();
-		}
-		_RebuildCacheIndex();
-	}
-}
-
-struct BitmapCacheEntry {
-	std::shared_ptr<PixelBuffer> buffer;
-	std::wstring key;
-};
-
-std::deque<BitmapCacheEntry> g_bitmap_cache;
-std::mutex g_bitmap_cache_mutex;
-std::unordered_map<std::wstring, size_t> g_bitmap_cache_index;
-
-void _RebuildBitmapCacheIndex() {
-	g_bitmap_cache_index.clear();
-	for (size_t i = 0; i < g_bitmap_cache.size(); ++i) {
-		g_bitmap_cache_index[g_bitmap_cache[i].key] = i;
-	}
-}
-
-std::shared_ptr<PixelBuffer> GetCachedBitmap(const std::wstring& key) {
-	std::lock_guard<std::mutex> lock(g_bitmap_cache_mutex);
-
-	auto it = g_bitmap_cache_index.find(key);
-	if (it != g_bitmap_cache_index.end()) {
-		size_t idx = it->second;
-		auto entry = g_bitmap_cache[idx];
-
-		if (idx > 0) {
-			g_bitmap_cache.erase(g_bitmap_cache.begin() + idx);
-			g_bitmap_cache.push_front(entry);
-			_RebuildBitmapCacheIndex();
-		}
-		return entry.buffer;
-	}
-	return nullptr;
-}
-
-void CacheBitmap(const std::wstring& key, std::shared_ptr<PixelBuffer> buffer) {
-	std::lock_guard<std::mutex> lock(g_bitmap_cache_mutex);
-
-	for (auto it = g_bitmap_cache.begin(); it != g_bitmap_cache.end(); ++it) {
-		if (it->key == key) {
-			g_bitmap_cache.erase(it);
-			break;
-		}
-	}
-
-	g_bitmap_cache.push_front({ buffer, key });
-
-	while (g_bitmap_cache.size() > MAX_CACHED_BITMAPS) {
-		g_bitmap_cache.pop_back();
-	}
-}
+void CacheBitmap(const BitmapKey& key, std::shared_ptr<PixelBuffer> buffer) {
+	const size_t bytes = sizeof(PixelBuffer) + buffer->pixels.capacity() * sizeof(COLORREF);
+	g_bitmap_cache.Put(key, std::move(buffer), bytes);
+}
 
 struct PixelBufferPool {
 	std::vector<std::vector<COLORREF>> buffers;
@@ -714,8 +1293,8 @@ PixelBufferPool g_pixel_pool;
 
 // PixelBuffer special member implementations
 PixelBuffer::~PixelBuffer() {
-	if (owns_memory && !pixels.empty()) {
-		g_pixel_pool.Release(std::move(pixels));
+	if (owns_memory && pixels.IsUnique()) {
+		g_pixel_pool.Release(pixels.Take());
 	}
 }
 
@@ -730,8 +1309,8 @@ PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept
 
 PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept {
 	if (this != &other) {
-		if (owns_memory && !pixels.empty()) {
-			g_pixel_pool.Release(std::move(pixels));
+		if (owns_memory && pixels.IsUnique()) {
+			g_pixel_pool.Release(pixels.Take());
 		}
 		pixels = std::move(other.pixels);
 		width = other.width;
@@ -743,6 +1322,206 @@ PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept {
 	return *this;
 }
 
+// ============================================================================
+// PIXEL CONVERSION: Swizzle and un-premultiply for all ingest paths
+// ============================================================================
+// Description:
+//   One conversion module for every place pixels enter the DLL in another
+//   layout: GDI+ LockBits rows (LoadImageFromFile_GDI, GetBitmapPixels_GDI),
+//   32 bpp BMP rows in the built-in decoder, and the resampler's
+//   premultiplied output.
+//
+// Algorithm:
+//   - Colors are divided by alpha through a Q16 reciprocal table,
+//     c' = min(255, (c * ceil(255 * 2^16 / a) + 2^15) >> 16), which equals
+//     c * 255 / a rounded half up for every c and a. Entries for a = 0 and
+//     a = 255 are 2^16, so those pixels pass through unchanged.
+//   - Blocks whose pixels are all opaque only swap R and B
+//   - AVX-512 (16 pixels) and AVX2 (8 pixels) gather the reciprocals;
+//     SSE2 swizzles 4 pixels and divides partially transparent blocks
+//     with the scalar table lookup
+//
+// Notes:
+//   The backend is picked once per call from the detected CPU features;
+//   every backend produces identical output.
+// ============================================================================
+namespace PixelConvert {
+	inline const std::array<uint32_t, 256>& Reciprocals() {
+		static const auto table = [] {
+			std::array<uint32_t, 256> t{};
+			t[0] = 65536;
+			for (uint32_t a = 1; a < 256; ++a) t[a] = (255u * 65536u + a - 1) / a;
+			return t;
+		}();
+		return table;
+	}
+
+	// One pixel: optionally swaps R and B, then divides colors by alpha;
+	// kClampToAlpha first limits colors to alpha (premultiplied input)
+	template<bool kSwap, bool kClampToAlpha>
+	inline uint32_t ConvertPixel(uint32_t p, const uint32_t* inv) {
+		if (kSwap) p = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+		const uint32_t a = p >> 24;
+		if (a == 255) return p;
+		const uint32_t limit = kClampToAlpha ? a : 255u;
+		const uint32_t r = (std::min(p & 0xFF, limit) * inv[a] + 32768) >> 16;
+		const uint32_t g = (std::min((p >> 8) & 0xFF, limit) * inv[a] + 32768) >> 16;
+		const uint32_t b = (std::min((p >> 16) & 0xFF, limit) * inv[a] + 32768) >> 16;
+		return (a << 24) | (std::min(b, 255u) << 16) | (std::min(g, 255u) << 8) | std::min(r, 255u);
+	}
+
+	template<bool kSwap, bool kClampToAlpha>
+	inline void Convert_Scalar(const uint32_t* src, uint32_t* dst, int count) {
+		const uint32_t* inv = Reciprocals().data();
+		for (int i = 0; i < count; ++i) dst[i] = ConvertPixel<kSwap, kClampToAlpha>(src[i], inv);
+	}
+
+	template<bool kSwap, bool kClampToAlpha>
+	inline void Convert_SSE2(const uint32_t* src, uint32_t* dst, int count) {
+		const uint32_t* inv = Reciprocals().data();
+		const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+		const __m128i low = _mm_set1_epi32(0xFF);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, alpha), alpha)) != 0xFFFF) {
+				for (int k = 0; k < 4; ++k) dst[i + k] = ConvertPixel<kSwap, kClampToAlpha>(src[i + k], inv);
+				continue;
+			}
+			if (kSwap) {
+				__m128i out = _mm_and_si128(v, keep);
+				out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(v, 16), low));
+				v = _mm_or_si128(out, _mm_slli_epi32(_mm_and_si128(v, low), 16));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+		}
+		for (; i < count; ++i) dst[i] = ConvertPixel<kSwap, kClampToAlpha>(src[i], inv);
+	}
+
+#ifdef _WIN64
+	template<bool kSwap, bool kClampToAlpha>
+	inline void Convert_AVX2(const uint32_t* src, uint32_t* dst, int count) {
+		const int* inv = reinterpret_cast<const int*>(Reciprocals().data());
+		const __m256i swap = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		const __m256i low = _mm256_set1_epi32(0xFF);
+		const __m256i max = _mm256_set1_epi32(255);
+		const __m256i round = _mm256_set1_epi32(32768);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			if (kSwap) v = _mm256_shuffle_epi8(v, swap);
+			const __m256i a = _mm256_srli_epi32(v, 24);
+			if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, low)) != -1) {
+				const __m256i r_inv = _mm256_i32gather_epi32(inv, a, 4);
+				const __m256i limit = kClampToAlpha ? a : max;
+				__m256i out = _mm256_slli_epi32(a, 24);
+				for (int shift = 0; shift < 24; shift += 8) {
+					__m256i c = _mm256_min_epu32(_mm256_and_si256(_mm256_srli_epi32(v, shift), low), limit);
+					c = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(c, r_inv), round), 16);
+					out = _mm256_or_si256(out, _mm256_slli_epi32(_mm256_min_epu32(c, max), shift));
+				}
+				v = out;
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+		}
+		Convert_SSE2<kSwap, kClampToAlpha>(src + i, dst + i, count - i);
+	}
+
+	template<bool kSwap, bool kClampToAlpha>
+	inline void Convert_AVX512(const uint32_t* src, uint32_t* dst, int count) {
+		const int* inv = reinterpret_cast<const int*>(Reciprocals().data());
+		const __m512i swap = _mm512_set4_epi32(0x0F0C0D0E, 0x0B08090A, 0x07040506, 0x03000102);
+		const __m512i low = _mm512_set1_epi32(0xFF);
+		const __m512i max = _mm512_set1_epi32(255);
+		const __m512i round = _mm512_set1_epi32(32768);
+		for (int i = 0; i < count; i += 16) {
+			const int remaining = count - i;
+			const __mmask16 lanes = remaining >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << remaining) - 1);
+			__m512i v = _mm512_maskz_loadu_epi32(lanes, src + i);
+			if (kSwap) v = _mm512_shuffle_epi8(v, swap);
+			const __m512i a = _mm512_srli_epi32(v, 24);
+			const __mmask16 partial = _mm512_mask_cmpneq_epi32_mask(lanes, a, low);
+			if (partial) {
+				const __m512i r_inv = _mm512_mask_i32gather_epi32(round, partial, a, inv, 4);
+				const __m512i limit = kClampToAlpha ? a : max;
+				__m512i out = _mm512_slli_epi32(a, 24);
+				for (int shift = 0; shift < 24; shift += 8) {
+					__m512i c = _mm512_min_epu32(_mm512_and_si512(_mm512_srli_epi32(v, shift), low), limit);
+					c = _mm512_srli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(c, r_inv), round), 16);
+					out = _mm512_or_si512(out, _mm512_slli_epi32(_mm512_min_epu32(c, max), shift));
+				}
+				v = _mm512_mask_mov_epi32(v, partial, out);
+			}
+			_mm512_mask_storeu_epi32(dst + i, lanes, v);
+		}
+	}
+#endif
+
+	using ConvertFn = void(*)(const uint32_t*, uint32_t*, int);
+
+	template<bool kSwap, bool kClampToAlpha>
+	inline ConvertFn SelectBackend() {
+#ifdef _WIN64
+		if (g_is_avx512_supported.load(std::memory_order_relaxed)) return Convert_AVX512<kSwap, kClampToAlpha>;
+		if (g_is_avx2_supported.load(std::memory_order_relaxed)) return Convert_AVX2<kSwap, kClampToAlpha>;
+		return Convert_SSE2<kSwap, kClampToAlpha>;
+#else
+		return g_is_sse2_supported.load(std::memory_order_relaxed) ? Convert_SSE2<kSwap, kClampToAlpha> : Convert_Scalar<kSwap, kClampToAlpha>;
+#endif
+	}
+
+	// GDI+ PixelFormat32bppARGB rows (B, G, R, A bytes) -> PixelBuffer
+	// layout (0xAABBGGRR), dividing colors by alpha
+	inline void ArgbRowsToPixels(const uint8_t* src, int src_stride, COLORREF* dst, int width, int height) {
+		const ConvertFn convert = SelectBackend<true, false>();
+		for (int y = 0; y < height; ++y) {
+			convert(reinterpret_cast<const uint32_t*>(src + static_cast<ptrdiff_t>(y) * src_stride),
+				reinterpret_cast<uint32_t*>(dst + static_cast<size_t>(y) * width), width);
+		}
+	}
+
+	// Premultiplied PixelBuffer pixels -> straight alpha, in place; colors
+	// above alpha are clamped and fully transparent pixels become 0
+	inline void Unpremultiply(COLORREF* pixels, size_t count) {
+		const ConvertFn convert = SelectBackend<false, true>();
+		auto* p = reinterpret_cast<uint32_t*>(pixels);
+		while (count > 0) {
+			const int chunk = static_cast<int>(std::min<size_t>(count, INT_MAX));
+			convert(p, p, chunk);
+			p += chunk;
+			count -= chunk;
+		}
+	}
+
+	// Swaps R and B of 32-bit pixels (BGRA <-> RGBA) and ORs in alpha_or;
+	// no division, for sources that already store straight alpha
+	inline void SwapRedBlue(const uint8_t* src, COLORREF* dst, int count, uint32_t alpha_or) {
+		int i = 0;
+#ifndef _WIN64
+		if (g_is_sse2_supported.load(std::memory_order_relaxed))
+#endif
+		{
+			const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+			const __m128i low = _mm_set1_epi32(0xFF);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(alpha_or));
+			for (; i + 4 <= count; i += 4) {
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+				__m128i out = _mm_and_si128(v, keep);
+				out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(v, 16), low));
+				out = _mm_or_si128(out, _mm_slli_epi32(_mm_and_si128(v, low), 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(out, alpha));
+			}
+		}
+		for (; i < count; ++i) {
+			uint32_t v;
+			std::memcpy(&v, src + i * 4, sizeof(v));
+			dst[i] = (v & 0xFF00FF00) | ((v >> 16) & 0xFF) | ((v & 0xFF) << 16) | alpha_or;
+		}
+	}
+}
+
 bool DetectAlphaChannel(const PixelBuffer& buffer) {
 	size_t sample_size = std::min<size_t>(buffer.pixels.size(), 1000);
 	size_t sample_step = std::max<size_t>(1, buffer.pixels.size() / sample_size);
@@ -759,17 +1538,9 @@ bool DetectAlphaChannel(const PixelBuffer& buffer) {
 std::optional<PixelBuffer> LoadImageFromFile_GDI(const std::wstring& file_path) {
 	InitializeGdiplus();
 
-	std::wstring cache_key = L"DECODE_" + GetNormalizedPathKey(file_path);
+	const BitmapKey cache_key = BitmapKey::ForFile(BitmapKind::Decoded, file_path);
 	auto cached = GetCachedBitmap(cache_key);
-	if (cached) {
-		PixelBuffer result;
-		result.width = cached->width;
-		result.height = cached->height;
-		result.has_alpha = cached->has_alpha;
-		result.pixels = cached->pixels;
-		result.owns_memory = false;
-		return result;
-	}
+	if (cached) return cached->Share();
 
 	auto bitmap = std::make_unique<Bitmap>(file_path.c_str());
 	if (!bitmap) {
@@ -809,178 +1580,865 @@ std::optional<PixelBuffer> LoadImageFromFile_GDI(const std::wstring& file_path)
 	}
 	buffer.pixels.resize(width * height);
 
-	BYTE* pixels = (BYTE*)bitmapData.Scan0;
-	int stride = bitmapData.Stride;
+	PixelConvert::ArgbRowsToPixels(static_cast<const uint8_t*>(bitmapData.Scan0), bitmapData.Stride,
+		buffer.pixels.data(), width, height);
+
+	bitmap->UnlockBits(&bitmapData);
+
+	buffer.has_alpha = hasAlpha && DetectAlphaChannel(buffer);
+
+	buffer.owns_memory = false;
+	CacheBitmap(cache_key, std::make_shared<PixelBuffer>(buffer.Share()));
+
+	return buffer;
+}
+
+// ============================================================================
+// BUILT-IN DECODER: PNG and BMP without GDI+
+// ============================================================================
+// Description:
+//   Decodes the two formats templates are normally saved in straight into
+//   the PixelBuffer layout (0xAABBGGRR), skipping the GDI+ Bitmap, LockBits
+//   conversion and per-pixel float math. Anything it does not handle
+//   (other formats, interlaced PNG, palettized or compressed BMP) returns
+//   nullopt and the caller falls back to GDI+.
+//
+// Supported:
+//   PNG - all color types and bit depths, tRNS transparency, non-interlaced;
+//         zlib inflate (stored, fixed and dynamic Huffman blocks) and the
+//         five scanline filters
+//   BMP - 24 bpp, and 32 bpp BI_RGB (opaque, as GDI+ reads it) or
+//         BI_BITFIELDS with the standard masks; bottom-up or top-down
+//
+// Notes:
+//   - 8-bit RGBA rows are already in PixelBuffer byte order and are copied
+//     as-is; 32 bpp BMP rows swap R and B four pixels per SSE2 operation
+//   - Colors are returned straight (not premultiplied), as stored in the file
+//   - Selected per search with ImageSearch_SetOption(L"Decoder", 1)
+//   - Sizes from file headers are checked against NATIVE_DECODE_MAX_PIXELS
+//     and the file length before anything is allocated; any failure,
+//     including bad_alloc, returns nullopt so GDI+ gets the file
+// ============================================================================
+#ifdef _WIN64
+#define NATIVE_DECODE_MAX_PIXELS (64ULL << 20)     // 256 MB of pixels
+#else
+#define NATIVE_DECODE_MAX_PIXELS (16ULL << 20)     // 64 MB of pixels
+#endif
+#define INFLATE_MAX_RATIO 1032                    // Deflate's largest output per input byte
+
+enum class ImageDecoder : int { Gdiplus = 0, Native = 1 };
+
+static std::atomic<int> g_image_decoder{ static_cast<int>(ImageDecoder::Gdiplus) };  // ImageSearch_SetOption(L"Decoder", n)
+
+namespace ImageDecode {
+	// Canonical Huffman code: number of codes per length and symbols in code order
+	struct Huffman {
+		uint16_t count[16] = {};
+		uint16_t symbol[288] = {};
+	};
+
+	class Inflater {
+	public:
+		Inflater(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		// Inflates a zlib stream; fails if the output would exceed max_output
+		bool Run(std::vector<uint8_t>& out, size_t max_output) {
+			if (m_size < 2) return false;
+			const uint8_t cmf = m_data[0], flg = m_data[1];
+			if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) return false;
+			m_pos = 2;
+			m_out = &out;
+			m_max_output = max_output;
+
+			int last;
+			do {
+				last = Bits(1);
+				const int type = Bits(2);
+				bool ok;
+				if (type == 0) ok = Stored();
+				else if (type == 1) ok = Fixed();
+				else if (type == 2) ok = Dynamic();
+				else ok = false;
+				if (!ok || m_error) return false;
+			} while (!last);
+			return true;
+		}
+
+	private:
+		int Bits(int need) {
+			uint32_t value = m_bit_buffer;
+			while (m_bit_count < need) {
+				if (m_pos >= m_size) {
+					m_error = true;
+					return 0;
+				}
+				value |= static_cast<uint32_t>(m_data[m_pos++]) << m_bit_count;
+				m_bit_count += 8;
+			}
+			m_bit_buffer = value >> need;
+			m_bit_count -= need;
+			return static_cast<int>(value & ((1u << need) - 1));
+		}
+
+		bool Stored() {
+			m_bit_buffer = 0;
+			m_bit_count = 0;
+			if (m_pos + 4 > m_size) return false;
+			const unsigned len = m_data[m_pos] | (m_data[m_pos + 1] << 8);
+			const unsigned nlen = m_data[m_pos + 2] | (m_data[m_pos + 3] << 8);
+			m_pos += 4;
+			if (len != (~nlen & 0xFFFF) || m_pos + len > m_size || m_out->size() + len > m_max_output) return false;
+			m_out->insert(m_out->end(), m_data + m_pos, m_data + m_pos + len);
+			m_pos += len;
+			return true;
+		}
+
+		int Decode(const Huffman& h) {
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; ++len) {
+				code |= Bits(1);
+				const int count = h.count[len];
+				if (code - count < first) return h.symbol[index + (code - first)];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+				if (m_error) return -1;
+			}
+			return -1;
+		}
+
+		// Returns false for over-subscribed code lengths
+		static bool Build(Huffman& h, const uint8_t* lengths, int n) {
+			std::fill(std::begin(h.count), std::end(h.count), static_cast<uint16_t>(0));
+			for (int i = 0; i < n; ++i) ++h.count[lengths[i]];
+			if (h.count[0] == n) return true;
+			int left = 1;
+			for (int len = 1; len < 16; ++len) {
+				left = (left << 1) - h.count[len];
+				if (left < 0) return false;
+			}
+			uint16_t offsets[16] = {};
+			for (int len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + h.count[len];
+			for (int i = 0; i < n; ++i) {
+				if (lengths[i]) h.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+			}
+			return true;
+		}
+
+		bool Codes(const Huffman& lengths, const Huffman& distances) {
+			static const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+				35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			static const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+				3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+			static const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+				257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+			static const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+				7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+			std::vector<uint8_t>& out = *m_out;
+			for (;;) {
+				int symbol = Decode(lengths);
+				if (symbol < 0 || m_error) return false;
+				if (symbol < 256) {
+					if (out.size() >= m_max_output) return false;
+					out.push_back(static_cast<uint8_t>(symbol));
+					continue;
+				}
+				if (symbol == 256) return true;
+
+				symbol -= 257;
+				if (symbol >= 29) return false;
+				const size_t length = kLengthBase[symbol] + Bits(kLengthExtra[symbol]);
+				const int dist_symbol = Decode(distances);
+				if (dist_symbol < 0 || dist_symbol >= 30) return false;
+				const size_t distance = kDistanceBase[dist_symbol] + Bits(kDistanceExtra[dist_symbol]);
+				if (m_error || distance > out.size() || out.size() + length > m_max_output) return false;
+				const size_t from = out.size() - distance;
+				for (size_t i = 0; i < length; ++i) out.push_back(out[from + i]);
+			}
+		}
 
-	for (int y = 0; y < height; y++) {
-		DWORD* row = (DWORD*)(pixels + y * stride);
-		for (int x = 0; x < width; x++) {
-			DWORD argb = row[x];
-			BYTE a = (argb >> 24) & 0xFF;
-			BYTE r = (argb >> 16) & 0xFF;
-			BYTE g = (argb >> 8) & 0xFF;
-			BYTE b = argb & 0xFF;
+		bool Fixed() {
+			static const auto tables = [] {
+				std::pair<Huffman, Huffman> t;
+				uint8_t lengths[288];
+				int i = 0;
+				for (; i < 144; ++i) lengths[i] = 8;
+				for (; i < 256; ++i) lengths[i] = 9;
+				for (; i < 280; ++i) lengths[i] = 7;
+				for (; i < 288; ++i) lengths[i] = 8;
+				Build(t.first, lengths, 288);
+				for (i = 0; i < 30; ++i) lengths[i] = 5;
+				Build(t.second, lengths, 30);
+				return t;
+			}();
+			return Codes(tables.first, tables.second);
+		}
 
-			if (a != 0 && a != 255) {
-				float invA = 255.0f / static_cast<float>(a);
-				int ur = static_cast<int>(std::round(r * invA));
-				int ug = static_cast<int>(std::round(g * invA));
-				int ub = static_cast<int>(std::round(b * invA));
-				r = static_cast<BYTE>(std::clamp(ur, 0, 255));
-				g = static_cast<BYTE>(std::clamp(ug, 0, 255));
-				b = static_cast<BYTE>(std::clamp(ub, 0, 255));
+		bool Dynamic() {
+			static const uint8_t kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			const int nlen = Bits(5) + 257;
+			const int ndist = Bits(5) + 1;
+			const int ncode = Bits(4) + 4;
+			if (m_error || nlen > 286 || ndist > 30) return false;
+
+			uint8_t lengths[320] = {};
+			for (int i = 0; i < ncode; ++i) lengths[kOrder[i]] = static_cast<uint8_t>(Bits(3));
+			Huffman code_lengths;
+			if (!Build(code_lengths, lengths, 19)) return false;
+
+			int index = 0;
+			while (index < nlen + ndist) {
+				int symbol = Decode(code_lengths);
+				if (symbol < 0 || m_error) return false;
+				if (symbol < 16) {
+					lengths[index++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				uint8_t repeat = 0;
+				int count;
+				if (symbol == 16) {
+					if (index == 0) return false;
+					repeat = lengths[index - 1];
+					count = 3 + Bits(2);
+				}
+				else if (symbol == 17) count = 3 + Bits(3);
+				else count = 11 + Bits(7);
+				if (index + count > nlen + ndist) return false;
+				while (count--) lengths[index++] = repeat;
 			}
-			buffer.pixels[y * width + x] = (a << 24) | (b << 16) | (g << 8) | r;
+			if (lengths[256] == 0) return false;
+
+			Huffman literal, distance;
+			if (!Build(literal, lengths, nlen) || !Build(distance, lengths + nlen, ndist)) return false;
+			return Codes(literal, distance);
 		}
+
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_pos = 0;
+		uint32_t m_bit_buffer = 0;
+		int m_bit_count = 0;
+		bool m_error = false;
+		std::vector<uint8_t>* m_out = nullptr;
+		size_t m_max_output = 0;
+	};
+
+	inline uint32_t ReadBE32(const uint8_t* p) {
+		return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
 	}
 
-	bitmap->UnlockBits(&bitmapData);
+	inline uint32_t ReadLE32(const uint8_t* p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
 
-	buffer.has_alpha = hasAlpha && DetectAlphaChannel(buffer);
+	inline uint8_t Paeth(int a, int b, int c) {
+		const int p = a + b - c;
+		const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
 
-	auto shared_buffer = std::make_shared<PixelBuffer>();
-	shared_buffer->width = buffer.width;
-	shared_buffer->height = buffer.height;
-	shared_buffer->has_alpha = buffer.has_alpha;
-	shared_buffer->pixels = buffer.pixels;
-	shared_buffer->owns_memory = false;
+	inline bool IsPlausibleSize(int64_t width, int64_t height) {
+		return width > 0 && height > 0 && width <= 32000 && height <= 32000 &&
+			static_cast<uint64_t>(width) * static_cast<uint64_t>(height) <= NATIVE_DECODE_MAX_PIXELS;
+	}
 
-	buffer.owns_memory = false;
+	inline bool AllocatePixels(PixelBuffer& buffer, int width, int height) {
+		if (!IsPlausibleSize(width, height)) return false;
+		buffer.width = width;
+		buffer.height = height;
+		buffer.pixels = g_pixel_pool.Acquire(static_cast<size_t>(width) * height);
+		return true;
+	}
 
-	CacheBitmap(cache_key, shared_buffer);
+	inline std::optional<PixelBuffer> DecodePng(const std::vector<uint8_t>& file) {
+		static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+		if (file.size() < 8 || std::memcmp(file.data(), kSignature, 8) != 0) return std::nullopt;
+
+		uint32_t width = 0, height = 0;
+		int depth = 0, color_type = -1;
+		std::vector<uint8_t> idat;
+		uint8_t palette[256][4];
+		int palette_size = 0;
+		bool has_trns = false;
+		uint16_t trns_key[3] = {};
+		for (auto& entry : palette) {
+			entry[0] = entry[1] = entry[2] = 0;
+			entry[3] = 255;
+		}
 
-	return buffer;
-}
+		size_t pos = 8;
+		while (pos + 12 <= file.size()) {
+			const uint32_t length = ReadBE32(&file[pos]);
+			const uint8_t* type = &file[pos + 4];
+			const uint8_t* data = &file[pos + 8];
+			if (length > file.size() - pos - 12) return std::nullopt;
+
+			if (std::memcmp(type, "IHDR", 4) == 0) {
+				if (length < 13) return std::nullopt;
+				width = ReadBE32(data);
+				height = ReadBE32(data + 4);
+				depth = data[8];
+				color_type = data[9];
+				if (data[10] != 0 || data[11] != 0 || data[12] != 0) return std::nullopt;  // interlaced: GDI+
+			}
+			else if (std::memcmp(type, "PLTE", 4) == 0) {
+				palette_size = std::min<int>(256, length / 3);
+				for (int i = 0; i < palette_size; ++i) {
+					palette[i][0] = data[i * 3];
+					palette[i][1] = data[i * 3 + 1];
+					palette[i][2] = data[i * 3 + 2];
+				}
+			}
+			else if (std::memcmp(type, "tRNS", 4) == 0) {
+				has_trns = true;
+				if (color_type == 3) {
+					for (uint32_t i = 0; i < std::min<uint32_t>(length, 256); ++i) palette[i][3] = data[i];
+				}
+				else if (color_type == 0 && length >= 2) {
+					trns_key[0] = static_cast<uint16_t>((data[0] << 8) | data[1]);
+				}
+				else if (color_type == 2 && length >= 6) {
+					for (int c = 0; c < 3; ++c) trns_key[c] = static_cast<uint16_t>((data[c * 2] << 8) | data[c * 2 + 1]);
+				}
+			}
+			else if (std::memcmp(type, "IDAT", 4) == 0) {
+				idat.insert(idat.end(), data, data + length);
+			}
+			else if (std::memcmp(type, "IEND", 4) == 0) {
+				break;
+			}
+			pos += 12 + static_cast<size_t>(length);
+		}
 
-std::optional<PixelBuffer> ScaleBitmap_GDI(const PixelBuffer& source, int newW, int newH) {
-	if (!source.IsValid()) return std::nullopt;
-	if (newW <= 0 || newH <= 0 || newW > 32000 || newH > 32000) return std::nullopt;
+		int channels;
+		switch (color_type) {
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: return std::nullopt;
+		}
+		const bool depth_ok = (depth == 8) || (depth == 16 && color_type != 3) ||
+			((depth == 1 || depth == 2 || depth == 4) && (color_type == 0 || color_type == 3));
+		if (!depth_ok || !IsPlausibleSize(width, height)) return std::nullopt;
+
+		// 64-bit so a hostile IHDR cannot wrap on x86; the inflated size must
+		// also be reachable from the IDAT bytes actually present
+		const uint64_t expected64 = ((static_cast<uint64_t>(width) * channels * depth + 7) / 8 + 1) * height;
+		if (expected64 > static_cast<uint64_t>(idat.size()) * INFLATE_MAX_RATIO || expected64 > SIZE_MAX) return std::nullopt;
+
+		const size_t row_bytes = (static_cast<size_t>(width) * channels * depth + 7) / 8;
+		const size_t pixel_bytes = std::max<size_t>(1, static_cast<size_t>(channels) * depth / 8);
+		const size_t expected = static_cast<size_t>(expected64);
+
+		std::vector<uint8_t> raw;
+		raw.reserve(expected);
+		Inflater inflater(idat.data(), idat.size());
+		if (!inflater.Run(raw, expected) || raw.size() != expected) return std::nullopt;
+
+		// Undo the scanline filters in place
+		for (uint32_t y = 0; y < height; ++y) {
+			uint8_t* row = &raw[y * (row_bytes + 1)];
+			const uint8_t filter = row[0];
+			uint8_t* cur = row + 1;
+			const uint8_t* prev = y > 0 ? cur - (row_bytes + 1) : nullptr;
+			switch (filter) {
+			case 0:
+				break;
+			case 1:
+				for (size_t i = pixel_bytes; i < row_bytes; ++i) cur[i] = static_cast<uint8_t>(cur[i] + cur[i - pixel_bytes]);
+				break;
+			case 2:
+				if (prev) for (size_t i = 0; i < row_bytes; ++i) cur[i] = static_cast<uint8_t>(cur[i] + prev[i]);
+				break;
+			case 3:
+				for (size_t i = 0; i < row_bytes; ++i) {
+					const int left = i >= pixel_bytes ? cur[i - pixel_bytes] : 0;
+					const int up = prev ? prev[i] : 0;
+					cur[i] = static_cast<uint8_t>(cur[i] + ((left + up) >> 1));
+				}
+				break;
+			case 4:
+				for (size_t i = 0; i < row_bytes; ++i) {
+					const int left = i >= pixel_bytes ? cur[i - pixel_bytes] : 0;
+					const int up = prev ? prev[i] : 0;
+					const int up_left = (prev && i >= pixel_bytes) ? prev[i - pixel_bytes] : 0;
+					cur[i] = static_cast<uint8_t>(cur[i] + Paeth(left, up, up_left));
+				}
+				break;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		PixelBuffer buffer;
+		if (!AllocatePixels(buffer, static_cast<int>(width), static_cast<int>(height))) return std::nullopt;
+
+		// Sample i of a row, scaled to 8 bits; key receives the full-precision value for tRNS
+		auto Sample = [&](const uint8_t* row, size_t i, uint16_t& key) -> uint8_t {
+			if (depth == 8) return static_cast<uint8_t>(key = row[i]);
+			if (depth == 16) {
+				key = static_cast<uint16_t>((row[i * 2] << 8) | row[i * 2 + 1]);
+				return row[i * 2];
+			}
+			const size_t bit = i * depth;
+			key = static_cast<uint16_t>((row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1));
+			return static_cast<uint8_t>(color_type == 3 ? key : key * (255 / ((1 << depth) - 1)));
+			};
+
+		for (uint32_t y = 0; y < height; ++y) {
+			const uint8_t* row = &raw[y * (row_bytes + 1) + 1];
+			COLORREF* out = &buffer.pixels[static_cast<size_t>(y) * width];
+			if (color_type == 6 && depth == 8) {
+				// R, G, B, A bytes are already the PixelBuffer layout
+				std::memcpy(out, row, static_cast<size_t>(width) * 4);
+				continue;
+			}
+			for (uint32_t x = 0; x < width; ++x) {
+				uint16_t k0 = 0, k1 = 0, k2 = 0, ka = 0;
+				uint32_t r, g, b, a = 255;
+				switch (color_type) {
+				case 0:
+					r = g = b = Sample(row, x, k0);
+					if (has_trns && k0 == trns_key[0]) a = 0;
+					break;
+				case 2:
+					r = Sample(row, x * 3, k0);
+					g = Sample(row, x * 3 + 1, k1);
+					b = Sample(row, x * 3 + 2, k2);
+					if (has_trns && k0 == trns_key[0] && k1 == trns_key[1] && k2 == trns_key[2]) a = 0;
+					break;
+				case 3: {
+					const int index = Sample(row, x, k0);
+					if (index >= palette_size) {
+						buffer.pixels.clear();
+						return std::nullopt;
+					}
+					r = palette[index][0];
+					g = palette[index][1];
+					b = palette[index][2];
+					a = palette[index][3];
+					break;
+				}
+				case 4:
+					r = g = b = Sample(row, x * 2, k0);
+					a = Sample(row, x * 2 + 1, ka);
+					break;
+				default:
+					r = Sample(row, x * 4, k0);
+					g = Sample(row, x * 4 + 1, k1);
+					b = Sample(row, x * 4 + 2, k2);
+					a = Sample(row, x * 4 + 3, ka);
+					break;
+				}
+				out[x] = (a << 24) | (b << 16) | (g << 8) | r;
+			}
+		}
+
+		buffer.has_alpha = (color_type == 4 || color_type == 6 || has_trns) && DetectAlphaChannel(buffer);
+		return buffer;
+	}
+
+	inline std::optional<PixelBuffer> DecodeBmp(const std::vector<uint8_t>& file) {
+		if (file.size() < 54 || file[0] != 'B' || file[1] != 'M') return std::nullopt;
+		const uint32_t data_offset = ReadLE32(&file[10]);
+		const uint32_t header_size = ReadLE32(&file[14]);
+		const int32_t width = static_cast<int32_t>(ReadLE32(&file[18]));
+		const int32_t raw_height = static_cast<int32_t>(ReadLE32(&file[22]));
+		const int bpp = file[28] | (file[29] << 8);
+		const uint32_t compression = ReadLE32(&file[30]);
+		if (header_size < 40 || raw_height == INT_MIN || (bpp != 24 && bpp != 32)) return std::nullopt;
+
+		bool use_alpha = false;
+		if (compression == 3) {  // BI_BITFIELDS: masks follow the 40-byte header
+			if (bpp != 32 || file.size() < 14 + 40 + 12) return std::nullopt;
+			const uint8_t* masks = &file[14 + 40];
+			if (ReadLE32(masks) != 0x00FF0000 || ReadLE32(masks + 4) != 0x0000FF00 || ReadLE32(masks + 8) != 0x000000FF) return std::nullopt;
+			use_alpha = header_size >= 56 && file.size() >= 14 + 56 && ReadLE32(masks + 12) == 0xFF000000;
+		}
+		else if (compression != 0) {
+			return std::nullopt;
+		}
+
+		const bool bottom_up = raw_height > 0;
+		const int height = bottom_up ? raw_height : -raw_height;
+		if (!IsPlausibleSize(width, height)) return std::nullopt;
+
+		// The pixel rows must be in the file before the buffer is allocated
+		const size_t stride = (static_cast<size_t>(width) * bpp / 8 + 3) & ~static_cast<size_t>(3);
+		if (data_offset > file.size() || static_cast<uint64_t>(stride) * height > file.size() - data_offset) {
+			return std::nullopt;
+		}
+
+		PixelBuffer buffer;
+		if (!AllocatePixels(buffer, width, height)) return std::nullopt;
+
+		for (int y = 0; y < height; ++y) {
+			const uint8_t* row = &file[data_offset + stride * (bottom_up ? height - 1 - y : y)];
+			COLORREF* out = &buffer.pixels[static_cast<size_t>(y) * width];
+			if (bpp == 32) {
+				PixelConvert::SwapRedBlue(row, out, width, use_alpha ? 0 : 0xFF000000);
+			}
+			else {
+				for (int x = 0; x < width; ++x) {
+					const uint8_t* p = row + x * 3;
+					out[x] = 0xFF000000 | (static_cast<uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+				}
+			}
+		}
 
-	size_t source_hash = 0;
-	size_t sample_step = std::max<size_t>(1, source.pixels.size() / 100);
-	for (size_t i = 0; i < source.pixels.size(); i += sample_step) {
-		source_hash ^= std::hash<COLORREF>{}(source.pixels[i]) + 0x9e3779b9 + (source_hash << 6) + (source_hash >> 2);
+		buffer.has_alpha = use_alpha && DetectAlphaChannel(buffer);
+		return buffer;
 	}
 
-	std::wstringstream cache_key_ss;
-	cache_key_ss << L"SCALED_" << std::hex << source_hash << L"_"
-		<< std::dec << source.width << L"x" << source.height
-		<< L"_to_" << newW << L"x" << newH;
-	std::wstring cache_key = cache_key_ss.str();
+	inline std::optional<PixelBuffer> DecodeFile(const std::wstring& file_path) {
+		try {
+			std::ifstream stream(std::filesystem::path(file_path), std::ios::binary);
+			if (!stream) return std::nullopt;
+			std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+			if (file.size() >= 8 && file[0] == 0x89 && file[1] == 'P') return DecodePng(file);
+			if (file.size() >= 2 && file[0] == 'B' && file[1] == 'M') return DecodeBmp(file);
+		}
+		catch (...) {
+			// Out of memory or I/O failure: GDI+ gets the file instead
+		}
+		return std::nullopt;
+	}
+}
 
+// Decodes with the built-in decoder when selected, falling back to GDI+.
+// A file the decoder declines is recorded under the native key as an empty
+// buffer, charged only its header, so later searches go straight to the
+// GDI+ entry instead of re-reading the file.
+std::optional<PixelBuffer> LoadImageFromFile(const std::wstring& file_path, ImageDecoder decoder) {
+	if (decoder != ImageDecoder::Native) return LoadImageFromFile_GDI(file_path);
+
+	const BitmapKey cache_key = BitmapKey::ForFile(BitmapKind::NativeDecoded, file_path);
 	auto cached = GetCachedBitmap(cache_key);
 	if (cached) {
-		PixelBuffer result;
-		result.width = cached->width;
-		result.height = cached->height;
-		result.has_alpha = cached->has_alpha;
-		result.pixels = cached->pixels;
-		result.owns_memory = false;
-		return result;
+		if (!cached->IsValid()) return LoadImageFromFile_GDI(file_path);
+		return cached->Share();
 	}
 
-	InitializeGdiplus();
+	auto decoded = ImageDecode::DecodeFile(file_path);
+	if (!decoded) {
+		auto fallback = LoadImageFromFile_GDI(file_path);
+		if (fallback) CacheBitmap(cache_key, std::make_shared<PixelBuffer>());
+		return fallback;
+	}
 
-	Bitmap srcBitmap(source.width, source.height, PixelFormat32bppARGB);
-	BitmapData srcData;
-	Rect srcRect(0, 0, source.width, source.height);
+	decoded->owns_memory = false;
+	CacheBitmap(cache_key, std::make_shared<PixelBuffer>(decoded->Share()));
 
-	if (srcBitmap.LockBits(&srcRect, ImageLockModeWrite, PixelFormat32bppARGB, &srcData) != Ok) {
-		return std::nullopt;
-	}
+	return decoded;
+}
+
+// ============================================================================
+// NATIVE RESAMPLER: Separable filtered scaling
+// ============================================================================
+// Description:
+//   Scales a PixelBuffer with a bicubic (Keys, a = -0.5), bilinear or area
+//   filter in two separable passes, without going through GDI+.
+//
+// Algorithm:
+//   1. Colors are premultiplied by alpha so transparent pixels do not bleed
+//      into their neighbours (buffers without alpha are filtered as-is)
+//   2. Per output column/row, contiguous tap windows with Q14 weights are
+//      built once; taps falling outside the image fold onto the edge pixel.
+//      When downscaling the filter is widened by the scale ratio.
+//   3. Horizontal pass: 8-bit pixels -> 16-bit intermediate with 6 fraction
+//      bits, two taps per _mm_madd_epi16
+//   4. Vertical pass: two intermediate rows per madd, 2 (SSE2) or 4 (AVX2)
+//      pixels per iteration, rounded back to 8 bits
+//   5. Colors are clamped to alpha and un-premultiplied
+//
+// Notes:
+//   All backends use identical integer arithmetic, so results do not depend
+//   on the CPU. Tap counts are padded to even with zero weights; the padded
+//   tap reads one extra zero pixel/row at the end of each buffer.
+// ============================================================================
+#define RESAMPLE_WEIGHT_BITS 14
+#define RESAMPLE_FRACTION_BITS 6
+
+enum class ScaleFilter : int { Bicubic = 0, Bilinear = 1, Area = 2 };
+
+static std::atomic<int> g_scale_filter{ static_cast<int>(ScaleFilter::Bicubic) };  // ImageSearch_SetOption(L"ScaleFilter", n)
+
+namespace Resample {
+	constexpr int kWeightOne = 1 << RESAMPLE_WEIGHT_BITS;
+	constexpr int kHorizontalShift = RESAMPLE_WEIGHT_BITS - RESAMPLE_FRACTION_BITS;
+	constexpr int kVerticalShift = RESAMPLE_WEIGHT_BITS + RESAMPLE_FRACTION_BITS;
+
+	// Tap windows of one axis: output i reads taps [first[i], first[i] + taps)
+	struct Contributions {
+		int taps = 0;                     // even
+		std::vector<int> first;
+		std::vector<int16_t> weights;     // taps per output, Q14, sum = kWeightOne
+		std::vector<int32_t> pairs;       // weights k, k+1 packed for _mm_madd_epi16
+	};
+
+	// x * a / 255 rounded to nearest, for x, a in [0, 255]
+	inline uint32_t MulDiv255(uint32_t x, uint32_t a) {
+		const uint32_t t = x * a + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	inline double Kernel(ScaleFilter filter, double t) {
+		t = std::abs(t);
+		if (filter == ScaleFilter::Bilinear) return t < 1.0 ? 1.0 - t : 0.0;
+		// Keys cubic with a = -0.5 (Catmull-Rom)
+		if (t < 1.0) return (1.5 * t - 2.5) * t * t + 1.0;
+		if (t < 2.0) return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+		return 0.0;
+	}
+
+	inline Contributions BuildContributions(int src_len, int dst_len, ScaleFilter filter) {
+		const double ratio = static_cast<double>(src_len) / dst_len;
+		const double stretch = std::max(1.0, ratio);
+		const double support = (filter == ScaleFilter::Bicubic ? 2.0 : filter == ScaleFilter::Bilinear ? 1.0 : 0.5) * stretch;
+		const int raw_taps = std::min(src_len, static_cast<int>(std::ceil(support * 2.0)) + 1);
+
+		Contributions c;
+		c.taps = (raw_taps + 1) & ~1;
+		c.first.resize(dst_len);
+		c.weights.assign(static_cast<size_t>(dst_len) * c.taps, 0);
+
+		std::vector<double> w(raw_taps);
+		for (int i = 0; i < dst_len; ++i) {
+			const double center = (i + 0.5) * ratio - 0.5;
+			const int lo = static_cast<int>(std::floor(center - support)) + 1;
+			const int first = std::clamp(lo, 0, src_len - raw_taps);
+			c.first[i] = first;
+
+			std::fill(w.begin(), w.end(), 0.0);
+			double total = 0.0;
+			const int hi = static_cast<int>(std::ceil(center + support));
+			for (int k = lo; k <= hi; ++k) {
+				double weight;
+				if (filter == ScaleFilter::Area) {
+					// Overlap of source pixel k with the output pixel's footprint
+					weight = std::min(k + 0.5, center + support) - std::max(k - 0.5, center - support);
+				}
+				else {
+					weight = Kernel(filter, (k - center) / stretch);
+				}
+				if (weight <= 0.0 && filter != ScaleFilter::Bicubic) continue;
+				const int slot = std::clamp(k, 0, src_len - 1) - first;
+				if (slot < 0 || slot >= raw_taps) continue;
+				w[slot] += weight;
+				total += weight;
+			}
+			if (total == 0.0) {
+				w[std::clamp(static_cast<int>(std::lround(center)), 0, src_len - 1) - first] = total = 1.0;
+			}
 
-	BYTE* srcPixels = (BYTE*)srcData.Scan0;
-	int srcStride = srcData.Stride;
+			// Quantize, putting the rounding residue on the largest tap
+			int16_t* q = &c.weights[static_cast<size_t>(i) * c.taps];
+			int sum = 0, largest = 0;
+			for (int k = 0; k < raw_taps; ++k) {
+				q[k] = static_cast<int16_t>(std::lround(w[k] / total * kWeightOne));
+				sum += q[k];
+				if (q[k] > q[largest]) largest = k;
+			}
+			q[largest] = static_cast<int16_t>(q[largest] + kWeightOne - sum);
+		}
 
-	for (int y = 0; y < source.height; y++) {
-		DWORD* row = (DWORD*)(srcPixels + y * srcStride);
-		for (int x = 0; x < source.width; x++) {
-			COLORREF pixel = source.pixels[y * source.width + x];
-			BYTE a = (pixel >> 24) & 0xFF;
-			BYTE b = (pixel >> 16) & 0xFF;
-			BYTE g = (pixel >> 8) & 0xFF;
-			BYTE r = pixel & 0xFF;
+		c.pairs.resize(c.weights.size() / 2);
+		for (size_t k = 0; k < c.pairs.size(); ++k) {
+			c.pairs[k] = static_cast<int32_t>(static_cast<uint16_t>(c.weights[k * 2]) |
+				(static_cast<uint32_t>(static_cast<uint16_t>(c.weights[k * 2 + 1])) << 16));
+		}
+		return c;
+	}
+
+	// Premultiplied copy with one zero pixel after each row and a zero row at the end
+	inline std::vector<uint32_t> Premultiply(const PixelBuffer& src, int stride) {
+		std::vector<uint32_t> out(static_cast<size_t>(stride) * (src.height + 1), 0);
+		for (int y = 0; y < src.height; ++y) {
+			const COLORREF* in = &src.pixels[static_cast<size_t>(y) * src.width];
+			uint32_t* row = &out[static_cast<size_t>(y) * stride];
+			if (!src.has_alpha) {
+				std::memcpy(row, in, src.width * sizeof(uint32_t));
+				continue;
+			}
+			for (int x = 0; x < src.width; ++x) {
+				const uint32_t p = in[x];
+				const uint32_t a = p >> 24;
+				if (a == 255) { row[x] = p; continue; }
+				uint32_t r = MulDiv255(p & 0xFF, a);
+				uint32_t g = MulDiv255((p >> 8) & 0xFF, a);
+				uint32_t b = MulDiv255((p >> 16) & 0xFF, a);
+				row[x] = (a << 24) | (b << 16) | (g << 8) | r;
+			}
+		}
+		return out;
+	}
+
+	// Horizontal pass of one row: 4 x int16 per output pixel
+	inline void Horizontal_Scalar(const uint32_t* src, int16_t* dst, const Contributions& c) {
+		const int count = static_cast<int>(c.first.size());
+		for (int i = 0; i < count; ++i) {
+			const uint32_t* px = src + c.first[i];
+			const int16_t* w = &c.weights[static_cast<size_t>(i) * c.taps];
+			int32_t acc[4] = { 0, 0, 0, 0 };
+			for (int k = 0; k < c.taps; ++k) {
+				for (int ch = 0; ch < 4; ++ch) acc[ch] += static_cast<int32_t>((px[k] >> (ch * 8)) & 0xFF) * w[k];
+			}
+			for (int ch = 0; ch < 4; ++ch) {
+				const int32_t v = (acc[ch] + (1 << (kHorizontalShift - 1))) >> kHorizontalShift;
+				dst[i * 4 + ch] = static_cast<int16_t>(std::clamp(v, -32768, 32767));
+			}
+		}
+	}
 
-			if (a != 0 && a != 255) {
-				float invA = 255.0f / static_cast<float>(a);
-				int ur = static_cast<int>(std::round(r * invA));
-				int ug = static_cast<int>(std::round(g * invA));
-				int ub = static_cast<int>(std::round(b * invA));
-				r = static_cast<BYTE>(std::clamp(ur, 0, 255));
-				g = static_cast<BYTE>(std::clamp(ug, 0, 255));
-				b = static_cast<BYTE>(std::clamp(ub, 0, 255));
+	// Vertical pass of int16 values [begin, end) of one output row; rows[k] is
+	// intermediate row first + k
+	inline void Vertical_Scalar(const int16_t* const* rows, const int16_t* w, int taps, int begin, int end, COLORREF* dst) {
+		for (int i = begin; i < end; i += 4) {
+			uint32_t pixel = 0;
+			for (int ch = 0; ch < 4; ++ch) {
+				int32_t acc = 0;
+				for (int k = 0; k < taps; ++k) acc += static_cast<int32_t>(rows[k][i + ch]) * w[k];
+				const int32_t v = (acc + (1 << (kVerticalShift - 1))) >> kVerticalShift;
+				pixel |= static_cast<uint32_t>(std::clamp(v, 0, 255)) << (ch * 8);
 			}
-			row[x] = (a << 24) | (r << 16) | (g << 8) | b;
+			dst[i / 4] = pixel;
 		}
 	}
 
-	srcBitmap.UnlockBits(&srcData);
+	// SSE2 is baseline on x64, so these serve both builds
+	inline void Horizontal_SSE2(const uint32_t* src, int16_t* dst, const Contributions& c) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+		const int count = static_cast<int>(c.first.size());
+		for (int i = 0; i < count; ++i) {
+			const uint32_t* px = src + c.first[i];
+			const int32_t* w = &c.pairs[static_cast<size_t>(i) * c.taps / 2];
+			__m128i acc = zero;
+			for (int k = 0; k < c.taps; k += 2) {
+				// r0 g0 b0 a0 r1 g1 b1 a1 -> r0 r1 g0 g1 b0 b1 a0 a1
+				__m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(px + k)), zero);
+				p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32(w[k / 2])));
+			}
+			acc = _mm_srai_epi32(_mm_add_epi32(acc, round), kHorizontalShift);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packs_epi32(acc, acc));
+		}
+	}
 
-	Bitmap dstBitmap(newW, newH, PixelFormat32bppARGB);
-	Graphics graphics(&dstBitmap);
-	graphics.SetInterpolationMode(InterpolationModeHighQualityBicubic);
-	graphics.SetPixelOffsetMode(PixelOffsetModeHighQuality);
-	graphics.SetSmoothingMode(SmoothingModeHighQuality);
+	inline void Vertical_SSE2(const int16_t* const* rows, const int16_t* w, int taps, int begin, int end, COLORREF* dst) {
+		const __m128i round = _mm_set1_epi32(1 << (kVerticalShift - 1));
+		int i = begin;
+		for (; i + 8 <= end; i += 8) {
+			__m128i acc_lo = _mm_setzero_si128(), acc_hi = _mm_setzero_si128();
+			for (int k = 0; k < taps; k += 2) {
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+				const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + i));
+				const __m128i wk = _mm_set1_epi32(static_cast<uint16_t>(w[k]) | (static_cast<uint32_t>(static_cast<uint16_t>(w[k + 1])) << 16));
+				acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wk));
+				acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wk));
+			}
+			acc_lo = _mm_srai_epi32(_mm_add_epi32(acc_lo, round), kVerticalShift);
+			acc_hi = _mm_srai_epi32(_mm_add_epi32(acc_hi, round), kVerticalShift);
+			const __m128i packed = _mm_packs_epi32(acc_lo, acc_hi);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i / 4), _mm_packus_epi16(packed, packed));
+		}
+		Vertical_Scalar(rows, w, taps, i, end, dst);
+	}
 
-	if (graphics.DrawImage(&srcBitmap, 0, 0, newW, newH) != Ok) {
-		return std::nullopt;
+#ifdef _WIN64
+	inline void Vertical_AVX2(const int16_t* const* rows, const int16_t* w, int taps, int begin, int end, COLORREF* dst) {
+		const __m256i round = _mm256_set1_epi32(1 << (kVerticalShift - 1));
+		int i = begin;
+		for (; i + 16 <= end; i += 16) {
+			__m256i acc_lo = _mm256_setzero_si256(), acc_hi = _mm256_setzero_si256();
+			for (int k = 0; k < taps; k += 2) {
+				const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + i));
+				const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k + 1] + i));
+				const __m256i wk = _mm256_set1_epi32(static_cast<uint16_t>(w[k]) | (static_cast<uint32_t>(static_cast<uint16_t>(w[k + 1])) << 16));
+				acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), wk));
+				acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), wk));
+			}
+			acc_lo = _mm256_srai_epi32(_mm256_add_epi32(acc_lo, round), kVerticalShift);
+			acc_hi = _mm256_srai_epi32(_mm256_add_epi32(acc_hi, round), kVerticalShift);
+			// Lanes hold pixels (0, 1 | 2, 3); packing keeps that order per lane
+			const __m256i packed = _mm256_packs_epi32(acc_lo, acc_hi);
+			const __m256i bytes = _mm256_packus_epi16(packed, packed);
+			const __m128i out = _mm_unpacklo_epi64(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i / 4), out);
+		}
+		Vertical_SSE2(rows, w, taps, i, end, dst);
 	}
+#endif
 
-	BitmapData dstData;
-	Rect dstRect(0, 0, newW, newH);
+	using HorizontalFn = void(*)(const uint32_t*, int16_t*, const Contributions&);
+	using VerticalFn = void(*)(const int16_t* const*, const int16_t*, int, int, int, COLORREF*);
 
-	if (dstBitmap.LockBits(&dstRect, ImageLockModeRead, PixelFormat32bppARGB, &dstData) != Ok) {
-		return std::nullopt;
-	}
+	inline PixelBuffer Scale(const PixelBuffer& src, int dst_w, int dst_h, ScaleFilter filter) {
+		HorizontalFn Horizontal = Horizontal_Scalar;
+		VerticalFn Vertical = Vertical_Scalar;
+#ifdef _WIN64
+		Horizontal = Horizontal_SSE2;
+		Vertical = g_is_avx2_supported.load(std::memory_order_relaxed) ? Vertical_AVX2 : Vertical_SSE2;
+#else
+		if (g_is_sse2_supported.load(std::memory_order_relaxed)) {
+			Horizontal = Horizontal_SSE2;
+			Vertical = Vertical_SSE2;
+		}
+#endif
 
-	PixelBuffer result;
-	result.width = newW;
-	result.height = newH;
-	result.has_alpha = source.has_alpha;
-	result.pixels = g_pixel_pool.Acquire(newW * newH);
-	if (result.pixels.capacity() < static_cast<size_t>(newW * newH)) {
-		dstBitmap.UnlockBits(&dstData);
-		return std::nullopt;
-	}
-	result.pixels.resize(newW * newH);
+		const Contributions cx = BuildContributions(src.width, dst_w, filter);
+		const Contributions cy = BuildContributions(src.height, dst_h, filter);
 
-	BYTE* dstPixels = (BYTE*)dstData.Scan0;
-	int dstStride = dstData.Stride;
+		const int stride = src.width + 1;
+		const std::vector<uint32_t> premultiplied = Premultiply(src, stride);
 
-	for (int y = 0; y < newH; y++) {
-		DWORD* row = (DWORD*)(dstPixels + y * dstStride);
-		for (int x = 0; x < newW; x++) {
-			DWORD argb = row[x];
-			BYTE a = (argb >> 24) & 0xFF;
-			BYTE r = (argb >> 16) & 0xFF;
-			BYTE g = (argb >> 8) & 0xFF;
-			BYTE b = argb & 0xFF;
+		// Intermediate: src.height rows of dst_w pixels plus a zero row for padded taps
+		const int values = dst_w * 4;
+		std::vector<int16_t> intermediate(static_cast<size_t>(values) * (src.height + 1), 0);
+		for (int y = 0; y < src.height; ++y) {
+			Horizontal(&premultiplied[static_cast<size_t>(y) * stride], &intermediate[static_cast<size_t>(y) * values], cx);
+		}
 
-			if (a != 0 && a != 255) {
-				float invA = 255.0f / static_cast<float>(a);
-				int ur = static_cast<int>(std::round(r * invA));
-				int ug = static_cast<int>(std::round(g * invA));
-				int ub = static_cast<int>(std::round(b * invA));
-				r = static_cast<BYTE>(std::clamp(ur, 0, 255));
-				g = static_cast<BYTE>(std::clamp(ug, 0, 255));
-				b = static_cast<BYTE>(std::clamp(ub, 0, 255));
+		PixelBuffer dst;
+		dst.width = dst_w;
+		dst.height = dst_h;
+		dst.has_alpha = src.has_alpha;
+		dst.pixels = g_pixel_pool.Acquire(static_cast<size_t>(dst_w) * dst_h);
+		dst.pixels.resize(static_cast<size_t>(dst_w) * dst_h);
+
+		std::vector<const int16_t*> rows(cy.taps);
+		for (int y = 0; y < dst_h; ++y) {
+			for (int k = 0; k < cy.taps; ++k) {
+				rows[k] = &intermediate[static_cast<size_t>(cy.first[y] + k) * values];
 			}
-			result.pixels[y * newW + x] = (a << 24) | (b << 16) | (g << 8) | r;
+			COLORREF* out = &dst.pixels[static_cast<size_t>(y) * dst_w];
+			Vertical(rows.data(), &cy.weights[static_cast<size_t>(y) * cy.taps], cy.taps, 0, values, out);
 		}
+
+		if (src.has_alpha) PixelConvert::Unpremultiply(dst.pixels.data(), dst.pixels.size());
+		return dst;
 	}
+}
+
+std::optional<PixelBuffer> ScaleBitmap(const PixelBuffer& source, int newW, int newH) {
+	if (!source.IsValid()) return std::nullopt;
+	if (newW <= 0 || newH <= 0 || newW > 32000 || newH > 32000) return std::nullopt;
 
-	dstBitmap.UnlockBits(&dstData);
+	const ScaleFilter filter = static_cast<ScaleFilter>(g_scale_filter.load(std::memory_order_relaxed));
 
-	auto shared_result = std::make_shared<PixelBuffer>();
-	shared_result->width = result.width;
-	shared_result->height = result.height;
-	shared_result->has_alpha = result.has_alpha;
-	shared_result->pixels = result.pixels;
-	shared_result->owns_memory = false;
+	const BitmapKey cache_key = BitmapKey::ForScaled(source.GetContentId(), newW, newH, static_cast<int>(filter));
 
-	result.owns_memory = false;
+	auto cached = GetCachedBitmap(cache_key);
+	if (cached) return cached->Share();
+
+	PixelBuffer result = Resample::Scale(source, newW, newH, filter);
 
-	CacheBitmap(cache_key, shared_result);
+	result.owns_memory = false;
+	CacheBitmap(cache_key, std::make_shared<PixelBuffer>(result.Share()));
 
 	return result;
 }
@@ -1022,30 +2480,8 @@ std::optional<PixelBuffer> GetBitmapPixels_GDI(HBITMAP hBitmap) {
 	buffer.pixels = g_pixel_pool.Acquire(pixel_count);
 	buffer.pixels.resize(pixel_count);
 
-	BYTE* pixels = (BYTE*)bitmapData.Scan0;
-	int stride = bitmapData.Stride;
-
-	for (int y = 0; y < height; y++) {
-		DWORD* row = (DWORD*)(pixels + y * stride);
-		for (int x = 0; x < width; x++) {
-			DWORD argb = row[x];
-			BYTE a = (argb >> 24) & 0xFF;
-			BYTE r = (argb >> 16) & 0xFF;
-			BYTE g = (argb >> 8) & 0xFF;
-			BYTE b = argb & 0xFF;
-
-			if (a != 0 && a != 255) {
-				float invA = 255.0f / static_cast<float>(a);
-				int ur = static_cast<int>(std::round(r * invA));
-				int ug = static_cast<int>(std::round(g * invA));
-				int ub = static_cast<int>(std::round(b * invA));
-				r = static_cast<BYTE>(std::clamp(ur, 0, 255));
-				g = static_cast<BYTE>(std::clamp(ug, 0, 255));
-				b = static_cast<BYTE>(std::clamp(ub, 0, 255));
-			}
-			buffer.pixels[y * width + x] = (a << 24) | (b << 16) | (g << 8) | r;
-		}
-	}
+	PixelConvert::ArgbRowsToPixels(static_cast<const uint8_t*>(bitmapData.Scan0), bitmapData.Stride,
+		buffer.pixels.data(), width, height);
 
 	bitmap->UnlockBits(&bitmapData);
 
@@ -1191,6 +2627,8 @@ std::optional<PixelBuffer> CaptureScreen_GDI(int iLeft, int iTop, int iRight, in
 	return result;
 }
 
+#define SPAN_MIN_AVERAGE_LENGTH 8
+
 namespace PixelComparison {
 	// Helper: Check if search region is valid
 	inline bool IsValidSearchRegion(int start_x, int start_y, int source_width, int source_height,
@@ -1233,70 +2671,130 @@ namespace PixelComparison {
 		return true;
 	}
 
-#ifdef _WIN64
-	inline bool CheckApproxMatch_AVX2(
-		const PixelBuffer& screen, const PixelBuffer& source,
-		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
-
-		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
-			return false;
-		}
-
-		int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+	// ========================================================================
+	// Specialized kernels
+	// ========================================================================
+	// Each kernel is instantiated per (transparency, tolerance == 0, width
+	// class) so the inner loops carry no runtime branches on those settings.
+	// SelectMatch picks one instance per search from the ISA's table; the
+	// CheckApproxMatch_* entry points remain as region-checked wrappers.
+	// Specialized kernels assume the position is valid.
+	// ========================================================================
+	struct OpaqueSpan {
+		int x;
+		int length;
+	};
+
+	// Per-template tables compiled once per search by SelectMatch
+	struct TemplateTables {
+		std::vector<uint64_t> care_masks;   // AVX512: byte care mask per 16-pixel block
+		std::vector<OpaqueSpan> spans;      // Opaque runs, row by row
+		std::vector<int> row_spans;         // Row y owns spans [row_spans[y], row_spans[y + 1])
+	};
+
+	using MatchFn = bool(*)(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables);
+
+	// Template width relative to the kernel's vector width
+	enum WidthClass {
+		WIDTH_NARROW = 0,    // Narrower than one vector: tail only
+		WIDTH_MULTIPLE = 1,  // Multiple of the vector width: no tail
+		WIDTH_GENERAL = 2,   // Full vectors followed by a tail
+		WIDTH_CLASS_COUNT = 3
+	};
+
+	inline int ClassifyWidth(int width, int lanes) noexcept {
+		if (width < lanes) return WIDTH_NARROW;
+		return (width % lanes == 0) ? WIDTH_MULTIPLE : WIDTH_GENERAL;
+	}
+
+	template<bool Transparent, bool Exact>
+	inline bool PixelMismatch(COLORREF source_pixel, COLORREF screen_pixel, int alpha_threshold, int tolerance) noexcept {
+		if constexpr (Transparent) {
+			if (static_cast<int>(source_pixel >> 24) < alpha_threshold) return false;
+		}
+		if constexpr (Exact) {
+			return ((source_pixel ^ screen_pixel) & 0x00FFFFFF) != 0;
+		}
+		else {
+			return std::abs((int)GetRValue(source_pixel) - (int)GetRValue(screen_pixel)) > tolerance ||
+				std::abs((int)GetGValue(source_pixel) - (int)GetGValue(screen_pixel)) > tolerance ||
+				std::abs((int)GetBValue(source_pixel) - (int)GetBValue(screen_pixel)) > tolerance;
+		}
+	}
 
-		const __m256i v_alpha_threshold = _mm256_set1_epi32(alpha_threshold);
-		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
-		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+	template<bool Transparent, bool Exact, int Width>
+	bool Match_Scalar(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables&) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(Transparent, tolerance);
 
 		for (int y = 0; y < source.height; ++y) {
 			const COLORREF* source_row = &source.pixels[y * source.width];
 			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-			int x = 0;
-			for (; x + 7 < source.width; x += 8) {
-				__m256i v_source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_row + x));
-
-				__m256i v_transparent_mask = _mm256_setzero_si256();
-				if (transparent_enabled) {
-					__m256i v_alpha = _mm256_srli_epi32(v_source, 24);
-					__m256i v_is_transparent = _mm256_cmpgt_epi32(v_alpha_threshold, v_alpha);
-					v_transparent_mask = v_is_transparent;
-				}
-
-				if (transparent_enabled && _mm256_testc_si256(v_transparent_mask, _mm256_set1_epi32(-1))) {
-					continue;
+			for (int x = 0; x < source.width; ++x) {
+				if (PixelMismatch<Transparent, Exact>(source_row[x], screen_row[x], alpha_threshold, tolerance)) {
+					return false;
 				}
+			}
+		}
+		return true;
+	}
 
-				__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_row + x));
-
-				__m256i v_source_rgb = _mm256_and_si256(v_source, v_rgb_mask);
-				__m256i v_screen_rgb = _mm256_and_si256(v_screen, v_rgb_mask);
+#ifdef _WIN64
+	// Row tails (width % lanes pixels) are compared with masked loads: masked-off
+	// lanes read as zero in both images and can never mismatch, so template
+	// rows never enter scalar code.
+	template<bool Transparent, bool Exact>
+	inline __m256i Mismatch_AVX2(__m256i v_source, __m256i v_screen, __m256i v_alpha_threshold,
+		__m256i v_rgb_mask, __m256i v_tolerance8) noexcept {
+		__m256i v_mismatch;
+		if constexpr (Exact) {
+			v_mismatch = _mm256_and_si256(_mm256_xor_si256(v_source, v_screen), v_rgb_mask);
+		}
+		else {
+			__m256i v_abs_diff = _mm256_or_si256(_mm256_subs_epu8(v_source, v_screen), _mm256_subs_epu8(v_screen, v_source));
+			v_mismatch = _mm256_and_si256(_mm256_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+		}
+		if constexpr (Transparent) {
+			__m256i v_is_transparent = _mm256_cmpgt_epi32(v_alpha_threshold, _mm256_srli_epi32(v_source, 24));
+			v_mismatch = _mm256_andnot_si256(v_is_transparent, v_mismatch);
+		}
+		return v_mismatch;
+	}
 
-				__m256i v_diff1 = _mm256_subs_epu8(v_source_rgb, v_screen_rgb);
-				__m256i v_diff2 = _mm256_subs_epu8(v_screen_rgb, v_source_rgb);
-				__m256i v_abs_diff = _mm256_or_si256(v_diff1, v_diff2);
+	template<bool Transparent, bool Exact, int Width>
+	bool Match_AVX2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables&) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(Transparent, tolerance);
 
-				__m256i v_check = _mm256_subs_epu8(v_abs_diff, v_tolerance8);
+		const __m256i v_alpha_threshold = _mm256_set1_epi32(alpha_threshold);
+		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+		const int tail_start = source.width & ~7;
+		const __m256i v_tail_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(source.width & 7),
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
 
-				__m256i v_mismatch = _mm256_andnot_si256(v_transparent_mask, v_check);
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-				if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
-					return false;
+			if constexpr (Width != WIDTH_NARROW) {
+				for (int x = 0; x < tail_start; x += 8) {
+					__m256i v_source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_row + x));
+					__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_row + x));
+					__m256i v_mismatch = Mismatch_AVX2<Transparent, Exact>(v_source, v_screen, v_alpha_threshold, v_rgb_mask, v_tolerance8);
+					if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
+						return false;
+					}
 				}
 			}
 
-			for (; x < source.width; ++x) {
-				COLORREF source_pixel = source_row[x];
-
-				if (transparent_enabled) {
-					uint8_t alpha = (source_pixel >> 24) & 0xFF;
-					if (alpha < alpha_threshold) continue;
-				}
-
-				COLORREF screen_pixel = screen_row[x];
-				if (std::abs((int)GetRValue(source_pixel) - (int)GetRValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetGValue(source_pixel) - (int)GetGValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetBValue(source_pixel) - (int)GetBValue(screen_pixel)) > tolerance) {
+			if constexpr (Width != WIDTH_MULTIPLE) {
+				__m256i v_source = _mm256_maskload_epi32(reinterpret_cast<const int*>(source_row + tail_start), v_tail_mask);
+				__m256i v_screen = _mm256_maskload_epi32(reinterpret_cast<const int*>(screen_row + tail_start), v_tail_mask);
+				__m256i v_mismatch = Mismatch_AVX2<Transparent, Exact>(v_source, v_screen, v_alpha_threshold, v_rgb_mask, v_tolerance8);
+				if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
 					return false;
 				}
 			}
@@ -1304,211 +2802,1442 @@ namespace PixelComparison {
 		return true;
 	}
 
-	inline bool CheckApproxMatch_AVX512(
-		const PixelBuffer& screen, const PixelBuffer& source,
-		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
+	// AVX512 compares bytes under a per-block care mask (R, G, B bytes of the
+	// pixels that count). Transparent searches precompute the masks once per
+	// template; otherwise the mask is the constant RGB pattern.
+	constexpr uint64_t kRgbByteMask = 0x7777777777777777ULL;
 
-		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
-			return false;
+	inline uint64_t TailByteMask(int pixels) noexcept {
+		return ((1ULL << (pixels * 4)) - 1) & kRgbByteMask;
+	}
+
+	// One __mmask64 per 16-pixel block of each template row, tail included
+	inline void BuildCareMasks_AVX512(const PixelBuffer& source, int alpha_threshold, std::vector<uint64_t>& care_masks) {
+		const int blocks = (source.width + 15) / 16;
+		const __m512i v_alpha_threshold = _mm512_set1_epi32(alpha_threshold);
+		const __m512i v_rgb_mask = _mm512_set1_epi32(0x00FFFFFF);
+		care_masks.resize(static_cast<size_t>(blocks) * source.height);
+
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			for (int b = 0; b < blocks; ++b) {
+				const int remaining = source.width - b * 16;
+				const __mmask16 lanes = remaining >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << remaining) - 1);
+				__m512i v_source = _mm512_maskz_loadu_epi32(lanes, source_row + b * 16);
+				__mmask16 opaque = _mm512_mask_cmp_epi32_mask(lanes, _mm512_srli_epi32(v_source, 24), v_alpha_threshold, _MM_CMPINT_NLT);
+				care_masks[static_cast<size_t>(y) * blocks + b] = _mm512_movepi8_mask(_mm512_maskz_mov_epi32(opaque, v_rgb_mask));
+			}
 		}
+	}
 
-		int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+	template<bool Exact>
+	inline bool Mismatch_AVX512(uint64_t care, __m512i v_source, __m512i v_screen, __m512i v_tolerance8) noexcept {
+		if constexpr (Exact) {
+			return _mm512_mask_cmpneq_epu8_mask(care, v_source, v_screen) != 0;
+		}
+		else {
+			__m512i v_abs_diff = _mm512_or_si512(_mm512_subs_epu8(v_source, v_screen), _mm512_subs_epu8(v_screen, v_source));
+			return _mm512_mask_cmpgt_epu8_mask(care, v_abs_diff, v_tolerance8) != 0;
+		}
+	}
 
-		const __m512i v_alpha_threshold = _mm512_set1_epi32(alpha_threshold << 24);
-		const __m512i v_rgb_mask = _mm512_set1_epi32(0x00FFFFFF);
+	template<bool Transparent, bool Exact, int Width>
+	bool Match_AVX512(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
 		const __m512i v_tolerance8 = _mm512_set1_epi8(static_cast<char>(tolerance));
+		const int tail_start = source.width & ~15;
+		const int tail_pixels = source.width & 15;
+		const __mmask16 tail_mask = static_cast<__mmask16>((1u << tail_pixels) - 1);
+		const uint64_t tail_care = TailByteMask(tail_pixels);
+		const int blocks = (source.width + 15) / 16;
 
 		for (int y = 0; y < source.height; ++y) {
 			const COLORREF* source_row = &source.pixels[y * source.width];
 			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
-
-			int x = 0;
-			for (; x + 15 < source.width; x += 16) {
-				__m512i v_source = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(source_row + x));
-
-				__mmask16 transparent_mask = 0;
-				if (transparent_enabled) {
-					__m512i v_alpha = _mm512_srli_epi32(v_source, 24);
-					transparent_mask = _mm512_cmp_epi32_mask(v_alpha, _mm512_set1_epi32(alpha_threshold), _MM_CMPINT_LT);
+			const uint64_t* row_care = Transparent ? tables.care_masks.data() + static_cast<size_t>(y) * blocks : nullptr;
+
+			if constexpr (Width != WIDTH_NARROW) {
+				for (int x = 0; x < tail_start; x += 16) {
+					__m512i v_source = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(source_row + x));
+					__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(screen_row + x));
+					const uint64_t care = Transparent ? row_care[x / 16] : kRgbByteMask;
+					if (Mismatch_AVX512<Exact>(care, v_source, v_screen, v_tolerance8)) {
+						return false;
+					}
 				}
+			}
 
-				if (transparent_enabled && transparent_mask == 0xFFFF) {
-					continue;
+			if constexpr (Width != WIDTH_MULTIPLE) {
+				__m512i v_source = _mm512_maskz_loadu_epi32(tail_mask, source_row + tail_start);
+				__m512i v_screen = _mm512_maskz_loadu_epi32(tail_mask, screen_row + tail_start);
+				const uint64_t care = Transparent ? row_care[tail_start / 16] : tail_care;
+				if (Mismatch_AVX512<Exact>(care, v_source, v_screen, v_tolerance8)) {
+					return false;
 				}
+			}
+		}
+		return true;
+	}
+#else
+	template<bool Transparent, bool Exact, int Width>
+	bool Match_SSE2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables&) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(Transparent, tolerance);
 
-				__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(screen_row + x));
-
-				__m512i v_source_rgb = _mm512_and_si512(v_source, v_rgb_mask);
-				__m512i v_screen_rgb = _mm512_and_si512(v_screen, v_rgb_mask);
+		const __m128i v_alpha_threshold = _mm_set1_epi32(alpha_threshold);
+		const __m128i v_rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i v_tolerance8 = _mm_set1_epi8(static_cast<char>(tolerance));
+		const __m128i v_zero = _mm_setzero_si128();
 
-				__m512i v_diff1 = _mm512_subs_epu8(v_source_rgb, v_screen_rgb);
-				__m512i v_diff2 = _mm512_subs_epu8(v_screen_rgb, v_source_rgb);
-				__m512i v_abs_diff = _mm512_or_si512(v_diff1, v_diff2);
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-				__mmask64 v_exceed = _mm512_cmp_epu8_mask(v_abs_diff, v_tolerance8, _MM_CMPINT_GT);
+			int x = 0;
+			if constexpr (Width != WIDTH_NARROW) {
+				for (; x + 3 < source.width; x += 4) {
+					__m128i v_source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_row + x));
+					__m128i v_screen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen_row + x));
+
+					__m128i v_mismatch;
+					if constexpr (Exact) {
+						v_mismatch = _mm_and_si128(_mm_xor_si128(v_source, v_screen), v_rgb_mask);
+					}
+					else {
+						__m128i v_abs_diff = _mm_or_si128(_mm_subs_epu8(v_source, v_screen), _mm_subs_epu8(v_screen, v_source));
+						v_mismatch = _mm_and_si128(_mm_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+					}
+					if constexpr (Transparent) {
+						__m128i v_is_transparent = _mm_cmplt_epi32(_mm_srli_epi32(v_source, 24), v_alpha_threshold);
+						v_mismatch = _mm_andnot_si128(v_is_transparent, v_mismatch);
+					}
 
-				__mmask64 transparent_byte_mask = 0;
-				if (transparent_enabled && transparent_mask != 0) {
-					uint64_t expanded = 0;
-					for (int p = 0; p < 16; ++p) {
-						if (transparent_mask & (1 << p)) {
-							expanded |= (0xFULL << (p * 4));
-						}
+					if (_mm_movemask_epi8(_mm_cmpeq_epi8(v_mismatch, v_zero)) != 0xFFFF) {
+						return false;
 					}
-					transparent_byte_mask = expanded;
 				}
+			}
 
-				__mmask64 v_mismatch = v_exceed & ~transparent_byte_mask;
-
-				if (v_mismatch != 0) {
-					return false;
+			if constexpr (Width != WIDTH_MULTIPLE) {
+				for (; x < source.width; ++x) {
+					if (PixelMismatch<Transparent, Exact>(source_row[x], screen_row[x], alpha_threshold, tolerance)) {
+						return false;
+					}
 				}
 			}
+		}
+		return true;
+	}
+#endif
 
-			if (g_is_avx2_supported.load(std::memory_order_relaxed)) {
-				for (; x + 7 < source.width; x += 8) {
-					__m256i v_source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_row + x));
-					__m256i v_transparent_mask = _mm256_setzero_si256();
+	// Dispatch tables indexed [transparent][exact][width class]
+#define MATCH_KERNEL_TABLE(K) { \
+	{ { K<false, false, WIDTH_NARROW>, K<false, false, WIDTH_MULTIPLE>, K<false, false, WIDTH_GENERAL> }, \
+	  { K<false, true, WIDTH_NARROW>, K<false, true, WIDTH_MULTIPLE>, K<false, true, WIDTH_GENERAL> } }, \
+	{ { K<true, false, WIDTH_NARROW>, K<true, false, WIDTH_MULTIPLE>, K<true, false, WIDTH_GENERAL> }, \
+	  { K<true, true, WIDTH_NARROW>, K<true, true, WIDTH_MULTIPLE>, K<true, true, WIDTH_GENERAL> } } }
 
-					if (transparent_enabled) {
-						__m256i v_alpha = _mm256_and_si256(v_source, _mm256_set1_epi32(0xFF000000));
-						__m256i v_is_transparent = _mm256_cmpgt_epi32(_mm256_set1_epi32(alpha_threshold << 24), v_alpha);
-						v_transparent_mask = v_is_transparent;
-					}
+	inline constexpr MatchFn kMatchTable_Scalar[2][2][WIDTH_CLASS_COUNT] = MATCH_KERNEL_TABLE(Match_Scalar);
+#ifdef _WIN64
+	inline constexpr MatchFn kMatchTable_AVX2[2][2][WIDTH_CLASS_COUNT] = MATCH_KERNEL_TABLE(Match_AVX2);
+	inline constexpr MatchFn kMatchTable_AVX512[2][2][WIDTH_CLASS_COUNT] = MATCH_KERNEL_TABLE(Match_AVX512);
+#else
+	inline constexpr MatchFn kMatchTable_SSE2[2][2][WIDTH_CLASS_COUNT] = MATCH_KERNEL_TABLE(Match_SSE2);
+#endif
+#undef MATCH_KERNEL_TABLE
 
-					if (transparent_enabled && _mm256_testc_si256(v_transparent_mask, _mm256_set1_epi32(-1))) {
-						continue;
+	// ========================================================================
+	// Opaque-span kernels
+	// ========================================================================
+	// Transparent templates are compiled once into per-row runs of opaque
+	// pixels. These kernels walk only the runs, so transparent pixels are
+	// never loaded and no alpha test remains in the loop. SelectMatch uses
+	// them when runs are long enough to fill vectors (cursor/icon templates).
+	// ========================================================================
+	inline int BuildOpaqueSpans(const PixelBuffer& source, int alpha_threshold, TemplateTables& tables) {
+		int opaque_pixels = 0;
+		tables.spans.clear();
+		tables.row_spans.assign(1, 0);
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			int x = 0;
+			while (x < source.width) {
+				if (static_cast<int>(source_row[x] >> 24) < alpha_threshold) { ++x; continue; }
+				const int begin = x;
+				while (x < source.width && static_cast<int>(source_row[x] >> 24) >= alpha_threshold) ++x;
+				tables.spans.push_back({ begin, x - begin });
+				opaque_pixels += x - begin;
+			}
+			tables.row_spans.push_back(static_cast<int>(tables.spans.size()));
+		}
+		return opaque_pixels;
+	}
+
+	template<bool Exact>
+	bool MatchSpans_Scalar(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+
+			for (int i = tables.row_spans[y]; i < tables.row_spans[y + 1]; ++i) {
+				const OpaqueSpan span = tables.spans[i];
+				for (int x = span.x; x < span.x + span.length; ++x) {
+					if (PixelMismatch<false, Exact>(source_row[x], screen_row[x], 0, tolerance)) {
+						return false;
 					}
+				}
+			}
+		}
+		return true;
+	}
 
-					__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_row + x));
-					__m256i v_source_rgb = _mm256_and_si256(v_source, _mm256_set1_epi32(0x00FFFFFF));
-					__m256i v_screen_rgb = _mm256_and_si256(v_screen, _mm256_set1_epi32(0x00FFFFFF));
+#ifdef _WIN64
+	template<bool Exact>
+	bool MatchSpans_AVX2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
+		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+		const __m256i v_lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
 
-					__m256i v_diff1 = _mm256_subs_epu8(v_source_rgb, v_screen_rgb);
-					__m256i v_diff2 = _mm256_subs_epu8(v_screen_rgb, v_source_rgb);
-					__m256i v_abs_diff = _mm256_or_si256(v_diff1, v_diff2);
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-					__m256i v_check = _mm256_subs_epu8(v_abs_diff, _mm256_set1_epi8(static_cast<char>(tolerance)));
-					__m256i v_mismatch = _mm256_andnot_si256(v_transparent_mask, v_check);
+			for (int i = tables.row_spans[y]; i < tables.row_spans[y + 1]; ++i) {
+				const OpaqueSpan span = tables.spans[i];
+				const COLORREF* source_run = source_row + span.x;
+				const COLORREF* screen_run = screen_row + span.x;
 
+				int x = 0;
+				for (; x + 8 <= span.length; x += 8) {
+					__m256i v_source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_run + x));
+					__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_run + x));
+					__m256i v_mismatch = Mismatch_AVX2<false, Exact>(v_source, v_screen, v_rgb_mask, v_rgb_mask, v_tolerance8);
+					if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
+						return false;
+					}
+				}
+				if (x < span.length) {
+					const __m256i v_tail_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(span.length - x), v_lane_index);
+					__m256i v_source = _mm256_maskload_epi32(reinterpret_cast<const int*>(source_run + x), v_tail_mask);
+					__m256i v_screen = _mm256_maskload_epi32(reinterpret_cast<const int*>(screen_run + x), v_tail_mask);
+					__m256i v_mismatch = Mismatch_AVX2<false, Exact>(v_source, v_screen, v_rgb_mask, v_rgb_mask, v_tolerance8);
 					if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
 						return false;
 					}
 				}
 			}
+		}
+		return true;
+	}
 
-			for (; x < source.width; ++x) {
-				COLORREF source_pixel = source_row[x];
+	template<bool Exact>
+	bool MatchSpans_AVX512(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
+		const __m512i v_tolerance8 = _mm512_set1_epi8(static_cast<char>(tolerance));
 
-				if (transparent_enabled) {
-					uint8_t alpha = (source_pixel >> 24) & 0xFF;
-					if (alpha < alpha_threshold) continue;
-				}
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-				COLORREF screen_pixel = screen_row[x];
-				if (std::abs((int)GetRValue(source_pixel) - (int)GetRValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetGValue(source_pixel) - (int)GetGValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetBValue(source_pixel) - (int)GetBValue(screen_pixel)) > tolerance) {
-					return false;
+			for (int i = tables.row_spans[y]; i < tables.row_spans[y + 1]; ++i) {
+				const OpaqueSpan span = tables.spans[i];
+				const COLORREF* source_run = source_row + span.x;
+				const COLORREF* screen_run = screen_row + span.x;
+
+				int x = 0;
+				for (; x + 16 <= span.length; x += 16) {
+					__m512i v_source = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(source_run + x));
+					__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(screen_run + x));
+					if (Mismatch_AVX512<Exact>(kRgbByteMask, v_source, v_screen, v_tolerance8)) {
+						return false;
+					}
+				}
+				if (x < span.length) {
+					const int remaining = span.length - x;
+					const __mmask16 tail_mask = static_cast<__mmask16>((1u << remaining) - 1);
+					__m512i v_source = _mm512_maskz_loadu_epi32(tail_mask, source_run + x);
+					__m512i v_screen = _mm512_maskz_loadu_epi32(tail_mask, screen_run + x);
+					if (Mismatch_AVX512<Exact>(TailByteMask(remaining), v_source, v_screen, v_tolerance8)) {
+						return false;
+					}
 				}
 			}
 		}
 		return true;
 	}
 #else
-	inline bool CheckApproxMatch_SSE2(
-		const PixelBuffer& screen, const PixelBuffer& source,
-		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
-
-		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
-			return false;
-		}
-
-		int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
-
-		const __m128i v_alpha_threshold = _mm_set1_epi32(alpha_threshold << 24);
+	template<bool Exact>
+	bool MatchSpans_SSE2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
 		const __m128i v_rgb_mask = _mm_set1_epi32(0x00FFFFFF);
-		const __m128i v_tolerance = _mm_set1_epi16(tolerance);
+		const __m128i v_tolerance8 = _mm_set1_epi8(static_cast<char>(tolerance));
 		const __m128i v_zero = _mm_setzero_si128();
 
 		for (int y = 0; y < source.height; ++y) {
 			const COLORREF* source_row = &source.pixels[y * source.width];
 			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
 
-			int x = 0;
-			for (; x + 3 < source.width; x += 4) {
-				__m128i v_source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_row + x));
-
-				__m128i v_transparent_mask = _mm_setzero_si128();
-				if (transparent_enabled) {
-					__m128i v_alpha = _mm_srli_epi32(v_source, 24);
-					__m128i v_alpha_compare = _mm_cmplt_epi32(v_alpha, _mm_set1_epi32(alpha_threshold));
-					v_transparent_mask = v_alpha_compare;
+			for (int i = tables.row_spans[y]; i < tables.row_spans[y + 1]; ++i) {
+				const OpaqueSpan span = tables.spans[i];
+				const COLORREF* source_run = source_row + span.x;
+				const COLORREF* screen_run = screen_row + span.x;
+
+				int x = 0;
+				for (; x + 4 <= span.length; x += 4) {
+					__m128i v_source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_run + x));
+					__m128i v_screen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen_run + x));
+					__m128i v_mismatch;
+					if constexpr (Exact) {
+						v_mismatch = _mm_and_si128(_mm_xor_si128(v_source, v_screen), v_rgb_mask);
+					}
+					else {
+						__m128i v_abs_diff = _mm_or_si128(_mm_subs_epu8(v_source, v_screen), _mm_subs_epu8(v_screen, v_source));
+						v_mismatch = _mm_and_si128(_mm_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+					}
+					if (_mm_movemask_epi8(_mm_cmpeq_epi8(v_mismatch, v_zero)) != 0xFFFF) {
+						return false;
+					}
 				}
-
-				int mask = _mm_movemask_epi8(v_transparent_mask);
-				if (transparent_enabled && mask == 0xFFFF) {
-					continue;
+				for (; x < span.length; ++x) {
+					if (PixelMismatch<false, Exact>(source_run[x], screen_run[x], 0, tolerance)) {
+						return false;
+					}
 				}
+			}
+		}
+		return true;
+	}
+#endif
 
-				__m128i v_screen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen_row + x));
+	// Span dispatch tables indexed [exact]
+	inline constexpr MatchFn kSpanTable_Scalar[2] = { MatchSpans_Scalar<false>, MatchSpans_Scalar<true> };
+#ifdef _WIN64
+	inline constexpr MatchFn kSpanTable_AVX2[2] = { MatchSpans_AVX2<false>, MatchSpans_AVX2<true> };
+	inline constexpr MatchFn kSpanTable_AVX512[2] = { MatchSpans_AVX512<false>, MatchSpans_AVX512<true> };
+#else
+	inline constexpr MatchFn kSpanTable_SSE2[2] = { MatchSpans_SSE2<false>, MatchSpans_SSE2<true> };
+#endif
 
-				__m128i v_source_rgb = _mm_and_si128(v_source, v_rgb_mask);
-				__m128i v_screen_rgb = _mm_and_si128(v_screen, v_rgb_mask);
+	// Picks the kernel instance for one search (CPU features read once) and
+	// compiles the template tables it needs. A transparent search whose
+	// template has no transparent pixel runs the opaque kernels.
+	inline MatchFn SelectMatch(const PixelBuffer& source, bool transparent_enabled, int tolerance,
+		TemplateTables& tables) {
+		const int e = (tolerance == 0) ? 1 : 0;
+		int t = 0;
+		bool use_spans = false;
+		if (transparent_enabled) {
+			const int opaque_pixels = BuildOpaqueSpans(source, ComputeAlphaThreshold(true, tolerance), tables);
+			if (opaque_pixels < source.width * source.height) {
+				t = 1;
+				use_spans = opaque_pixels >= SPAN_MIN_AVERAGE_LENGTH * static_cast<int>(tables.spans.size());
+			}
+		}
 
-				__m128i v_source_lo = _mm_unpacklo_epi8(v_source_rgb, v_zero);
-				__m128i v_source_hi = _mm_unpackhi_epi8(v_source_rgb, v_zero);
-				__m128i v_screen_lo = _mm_unpacklo_epi8(v_screen_rgb, v_zero);
-				__m128i v_screen_hi = _mm_unpackhi_epi8(v_screen_rgb, v_zero);
+#ifdef _WIN64
+		if (g_is_avx512_supported.load(std::memory_order_relaxed)) {
+			if (use_spans) return kSpanTable_AVX512[e];
+			if (t) BuildCareMasks_AVX512(source, ComputeAlphaThreshold(true, tolerance), tables.care_masks);
+			return kMatchTable_AVX512[t][e][ClassifyWidth(source.width, 16)];
+		}
+		if (g_is_avx2_supported.load(std::memory_order_relaxed)) {
+			if (use_spans) return kSpanTable_AVX2[e];
+			return kMatchTable_AVX2[t][e][ClassifyWidth(source.width, 8)];
+		}
+#else
+		if (g_is_sse2_supported.load(std::memory_order_relaxed)) {
+			if (use_spans) return kSpanTable_SSE2[e];
+			return kMatchTable_SSE2[t][e][ClassifyWidth(source.width, 4)];
+		}
+#endif
+		if (use_spans) return kSpanTable_Scalar[e];
+		return kMatchTable_Scalar[t][e][WIDTH_GENERAL];
+	}
 
-				__m128i v_diff_lo = _mm_sub_epi16(v_source_lo, v_screen_lo);
-				__m128i v_diff_hi = _mm_sub_epi16(v_source_hi, v_screen_hi);
+#ifdef _WIN64
+	inline bool CheckApproxMatch_AVX2(
+		const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
 
-				__m128i v_abs_diff_lo = _mm_max_epi16(v_diff_lo, _mm_sub_epi16(v_zero, v_diff_lo));
-				__m128i v_abs_diff_hi = _mm_max_epi16(v_diff_hi, _mm_sub_epi16(v_zero, v_diff_hi));
+		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
+			return false;
+		}
+		const MatchFn match = kMatchTable_AVX2[transparent_enabled ? 1 : 0][tolerance == 0 ? 1 : 0][ClassifyWidth(source.width, 8)];
+		return match(screen, source, start_x, start_y, tolerance, TemplateTables());
+	}
 
-				__m128i v_check_lo = _mm_cmpgt_epi16(v_abs_diff_lo, v_tolerance);
-				__m128i v_check_hi = _mm_cmpgt_epi16(v_abs_diff_hi, v_tolerance);
+	inline bool CheckApproxMatch_AVX512(
+		const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
 
-				__m128i v_check = _mm_packs_epi16(v_check_lo, v_check_hi);
-				__m128i v_mismatch = _mm_andnot_si128(v_transparent_mask, v_check);
+		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
+			return false;
+		}
+		TemplateTables tables;
+		if (transparent_enabled) {
+			BuildCareMasks_AVX512(source, ComputeAlphaThreshold(true, tolerance), tables.care_masks);
+		}
+		const MatchFn match = kMatchTable_AVX512[transparent_enabled ? 1 : 0][tolerance == 0 ? 1 : 0][ClassifyWidth(source.width, 16)];
+		return match(screen, source, start_x, start_y, tolerance, tables);
+	}
+#else
+	inline bool CheckApproxMatch_SSE2(
+		const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
 
-				if (_mm_movemask_epi8(v_mismatch) != 0) {
-					return false;
-				}
-			}
+		if (!IsValidSearchRegion(start_x, start_y, source.width, source.height, screen.width, screen.height)) {
+			return false;
+		}
+		const MatchFn match = kMatchTable_SSE2[transparent_enabled ? 1 : 0][tolerance == 0 ? 1 : 0][ClassifyWidth(source.width, 4)];
+		return match(screen, source, start_x, start_y, tolerance, TemplateTables());
+	}
+#endif
+}
 
-			for (; x < source.width; ++x) {
-				COLORREF source_pixel = source_row[x];
+// ============================================================================
+// TEMPLATE PROFILE: Anchor pixels
+// ============================================================================
+// Description:
+//   A template is prepared once per SearchForBitmap call. Preparation picks a
+//   few distinctive opaque pixels (anchors) that every match has to agree with.
+//   The source is then scanned testing only those anchors, several x positions
+//   per SIMD instruction, and the surviving positions form a candidate list
+//   that is verified with the full PixelComparison kernels.
+//
+// Anchor Selection:
+//   - Only opaque pixels (alpha >= threshold when transparency is enabled)
+//   - Colors are bucketed into a 12-bit histogram: rare buckets rank first,
+//     colorful pixels beat grays (flat UI backgrounds are mostly gray)
+//   - Later anchors prefer unused buckets, then distance from earlier anchors
+// ============================================================================
+#define MAX_TEMPLATE_ANCHORS 4
+#define ANCHOR_CANDIDATE_POOL 256
 
-				if (transparent_enabled) {
-					uint8_t alpha = (source_pixel >> 24) & 0xFF;
-					if (alpha < alpha_threshold) continue;
-				}
+struct AnchorPixel {
+	int dx = 0, dy = 0;
+	COLORREF color = 0;
+};
 
-				COLORREF screen_pixel = screen_row[x];
-				if (std::abs((int)GetRValue(source_pixel) - (int)GetRValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetGValue(source_pixel) - (int)GetGValue(screen_pixel)) > tolerance ||
-					std::abs((int)GetBValue(source_pixel) - (int)GetBValue(screen_pixel)) > tolerance) {
-					return false;
+struct TemplateProfile {
+	std::vector<AnchorPixel> anchors;
+	// Largest all-opaque rectangle of the template (whole template when opaque)
+	int opaque_x = 0, opaque_y = 0, opaque_w = 0, opaque_h = 0;
+	// Per-channel (R, G, B) sums over the opaque rectangle
+	uint64_t opaque_sum[3] = { 0, 0, 0 };
+};
+
+inline int ColorBucket(COLORREF c) {
+	return ((GetRValue(c) >> 4) << 8) | ((GetGValue(c) >> 4) << 4) | (GetBValue(c) >> 4);
+}
+
+inline int ColorChroma(COLORREF c) {
+	int r = GetRValue(c), g = GetGValue(c), b = GetBValue(c);
+	return std::max({ r, g, b }) - std::min({ r, g, b });
+}
+
+// Largest rectangle of opaque pixels (histogram/stack method, O(width * height))
+void FindLargestOpaqueRect(const PixelBuffer& Target, bool transparent_enabled, int alpha_threshold,
+	TemplateProfile& profile) {
+	std::vector<int> heights(Target.width + 1, 0);
+	std::vector<int> stack;
+	int best_area = 0;
+	for (int y = 0; y < Target.height; ++y) {
+		for (int x = 0; x < Target.width; ++x) {
+			COLORREF pixel = Target.pixels[y * Target.width + x];
+			bool opaque = !transparent_enabled || static_cast<int>((pixel >> 24) & 0xFF) >= alpha_threshold;
+			heights[x] = opaque ? heights[x] + 1 : 0;
+		}
+		stack.clear();
+		for (int x = 0; x <= Target.width; ++x) {
+			while (!stack.empty() && heights[stack.back()] >= heights[x]) {
+				int h = heights[stack.back()];
+				stack.pop_back();
+				int left = stack.empty() ? 0 : stack.back() + 1;
+				int area = h * (x - left);
+				if (area > best_area) {
+					best_area = area;
+					profile.opaque_x = left;
+					profile.opaque_y = y - h + 1;
+					profile.opaque_w = x - left;
+					profile.opaque_h = h;
+				}
+			}
+			stack.push_back(x);
+		}
+	}
+}
+
+TemplateProfile BuildTemplateProfile(const PixelBuffer& Target, bool transparent_enabled, int tolerance) {
+	TemplateProfile profile;
+	int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+	FindLargestOpaqueRect(Target, transparent_enabled, alpha_threshold, profile);
+	for (int y = 0; y < profile.opaque_h; ++y) {
+		const COLORREF* row = &Target.pixels[(profile.opaque_y + y) * Target.width + profile.opaque_x];
+		for (int x = 0; x < profile.opaque_w; ++x) {
+			profile.opaque_sum[0] += GetRValue(row[x]);
+			profile.opaque_sum[1] += GetGValue(row[x]);
+			profile.opaque_sum[2] += GetBValue(row[x]);
+		}
+	}
+
+	std::vector<int> histogram(4096, 0);
+	std::vector<int> opaque;
+	opaque.reserve(Target.pixels.size());
+	for (int i = 0; i < static_cast<int>(Target.pixels.size()); ++i) {
+		COLORREF pixel = Target.pixels[i];
+		if (transparent_enabled && static_cast<int>((pixel >> 24) & 0xFF) < alpha_threshold) continue;
+		histogram[ColorBucket(pixel)]++;
+		opaque.push_back(i);
+	}
+	if (opaque.empty()) return profile;
+
+	// Rank by bucket rarity, then chroma, then scan order (deterministic)
+	auto rank_less = [&](int a, int b) {
+		int fa = histogram[ColorBucket(Target.pixels[a])], fb = histogram[ColorBucket(Target.pixels[b])];
+		if (fa != fb) return fa < fb;
+		int ca = ColorChroma(Target.pixels[a]), cb = ColorChroma(Target.pixels[b]);
+		if (ca != cb) return ca > cb;
+		return a < b;
+		};
+	size_t pool_size = std::min<size_t>(opaque.size(), ANCHOR_CANDIDATE_POOL);
+	std::partial_sort(opaque.begin(), opaque.begin() + pool_size, opaque.end(), rank_less);
+	opaque.resize(pool_size);
+
+	std::vector<int> used_buckets;
+	std::vector<bool> taken(pool_size, false);
+	while (profile.anchors.size() < MAX_TEMPLATE_ANCHORS) {
+		int best = -1;
+		bool best_new_bucket = false;
+		int best_distance = -1;
+		for (size_t i = 0; i < pool_size; ++i) {
+			if (taken[i]) continue;
+			int px = opaque[i] % Target.width, py = opaque[i] / Target.width;
+			bool new_bucket = std::find(used_buckets.begin(), used_buckets.end(),
+				ColorBucket(Target.pixels[opaque[i]])) == used_buckets.end();
+			int distance = INT_MAX;
+			for (const auto& a : profile.anchors) {
+				distance = std::min(distance, std::max(std::abs(a.dx - px), std::abs(a.dy - py)));
+			}
+			if (distance == 0) continue;
+			if (best < 0 || (new_bucket && !best_new_bucket) ||
+				(new_bucket == best_new_bucket && distance > best_distance)) {
+				best = static_cast<int>(i);
+				best_new_bucket = new_bucket;
+				best_distance = distance;
+			}
+		}
+		if (best < 0) break;
+
+		taken[best] = true;
+		AnchorPixel anchor;
+		anchor.dx = opaque[best] % Target.width;
+		anchor.dy = opaque[best] / Target.width;
+		anchor.color = Target.pixels[opaque[best]] & 0x00FFFFFF;
+		used_buckets.push_back(ColorBucket(anchor.color));
+		profile.anchors.push_back(anchor);
+	}
+	return profile;
+}
+
+// ============================================================================
+// ANCHOR SCAN: Candidate generation
+// ============================================================================
+// Description:
+//   Tests the profile anchors for every x in [x_begin, x_end) of one source
+//   row and appends the positions where all anchors are within tolerance.
+//   SIMD variants test 4 (SSE2), 8 (AVX2) or 16 (AVX512) adjacent x positions
+//   per instruction and stop as soon as no lane survives. The last partial
+//   block falls back to scalar tests so loads never run past the source row.
+// ============================================================================
+namespace AnchorScan {
+	using ScanRowFn = void(*)(const PixelBuffer& screen, const TemplateProfile& profile,
+		int y, int x_begin, int x_end, int tolerance, std::vector<int>& candidates);
+
+	inline bool PixelWithinTolerance(COLORREF a, COLORREF b, int tolerance) noexcept {
+		return std::abs((int)GetRValue(a) - (int)GetRValue(b)) <= tolerance &&
+			std::abs((int)GetGValue(a) - (int)GetGValue(b)) <= tolerance &&
+			std::abs((int)GetBValue(a) - (int)GetBValue(b)) <= tolerance;
+	}
+
+	inline bool AnchorsMatchAt(const PixelBuffer& screen, const TemplateProfile& profile,
+		int x, int y, int tolerance) noexcept {
+		for (const auto& a : profile.anchors) {
+			if (!PixelWithinTolerance(screen.pixels[(y + a.dy) * screen.width + x + a.dx], a.color, tolerance)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline void ScanRow_Scalar(const PixelBuffer& screen, const TemplateProfile& profile,
+		int y, int x_begin, int x_end, int tolerance, std::vector<int>& candidates) {
+		for (int x = x_begin; x < x_end; ++x) {
+			if (AnchorsMatchAt(screen, profile, x, y, tolerance)) {
+				candidates.push_back(x);
+			}
+		}
+	}
+
+#ifdef _WIN64
+	inline void ScanRow_AVX2(const PixelBuffer& screen, const TemplateProfile& profile,
+		int y, int x_begin, int x_end, int tolerance, std::vector<int>& candidates) {
+		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+		const __m256i v_zero = _mm256_setzero_si256();
+
+		int x = x_begin;
+		for (; x + 7 < x_end; x += 8) {
+			unsigned int survivors = 0xFF;
+			for (const auto& a : profile.anchors) {
+				const COLORREF* row = &screen.pixels[(y + a.dy) * screen.width + x + a.dx];
+				__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row));
+				__m256i v_anchor = _mm256_set1_epi32(static_cast<int>(a.color));
+				__m256i v_abs_diff = _mm256_or_si256(_mm256_subs_epu8(v_screen, v_anchor), _mm256_subs_epu8(v_anchor, v_screen));
+				__m256i v_exceed = _mm256_and_si256(_mm256_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+				__m256i v_lane_ok = _mm256_cmpeq_epi32(v_exceed, v_zero);
+				survivors &= static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(v_lane_ok)));
+				if (survivors == 0) break;
+			}
+			while (survivors) {
+				unsigned long lane;
+				_BitScanForward(&lane, survivors);
+				candidates.push_back(x + static_cast<int>(lane));
+				survivors &= survivors - 1;
+			}
+		}
+		ScanRow_Scalar(screen, profile, y, x, x_end, tolerance, candidates);
+	}
+
+	inline void ScanRow_AVX512(const PixelBuffer& screen, const TemplateProfile& profile,
+		int y, int x_begin, int x_end, int tolerance, std::vector<int>& candidates) {
+		const __m512i v_rgb_mask = _mm512_set1_epi32(0x00FFFFFF);
+		const __m512i v_tolerance8 = _mm512_set1_epi8(static_cast<char>(tolerance));
+
+		int x = x_begin;
+		for (; x + 15 < x_end; x += 16) {
+			__mmask16 survivors = 0xFFFF;
+			for (const auto& a : profile.anchors) {
+				const COLORREF* row = &screen.pixels[(y + a.dy) * screen.width + x + a.dx];
+				__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(row));
+				__m512i v_anchor = _mm512_set1_epi32(static_cast<int>(a.color));
+				__m512i v_abs_diff = _mm512_or_si512(_mm512_subs_epu8(v_screen, v_anchor), _mm512_subs_epu8(v_anchor, v_screen));
+				__m512i v_exceed = _mm512_subs_epu8(v_abs_diff, v_tolerance8);
+				survivors &= _mm512_testn_epi32_mask(v_exceed, v_rgb_mask);
+				if (survivors == 0) break;
+			}
+			unsigned int bits = survivors;
+			while (bits) {
+				unsigned long lane;
+				_BitScanForward(&lane, bits);
+				candidates.push_back(x + static_cast<int>(lane));
+				bits &= bits - 1;
+			}
+		}
+
+		if (g_is_avx2_supported.load(std::memory_order_relaxed)) {
+			ScanRow_AVX2(screen, profile, y, x, x_end, tolerance, candidates);
+		}
+		else {
+			ScanRow_Scalar(screen, profile, y, x, x_end, tolerance, candidates);
+		}
+	}
+#else
+	inline void ScanRow_SSE2(const PixelBuffer& screen, const TemplateProfile& profile,
+		int y, int x_begin, int x_end, int tolerance, std::vector<int>& candidates) {
+		const __m128i v_rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i v_tolerance8 = _mm_set1_epi8(static_cast<char>(tolerance));
+		const __m128i v_zero = _mm_setzero_si128();
+
+		int x = x_begin;
+		for (; x + 3 < x_end; x += 4) {
+			int survivors = 0xF;
+			for (const auto& a : profile.anchors) {
+				const COLORREF* row = &screen.pixels[(y + a.dy) * screen.width + x + a.dx];
+				__m128i v_screen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+				__m128i v_anchor = _mm_set1_epi32(static_cast<int>(a.color));
+				__m128i v_abs_diff = _mm_or_si128(_mm_subs_epu8(v_screen, v_anchor), _mm_subs_epu8(v_anchor, v_screen));
+				__m128i v_exceed = _mm_and_si128(_mm_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+				__m128i v_lane_ok = _mm_cmpeq_epi32(v_exceed, v_zero);
+				survivors &= _mm_movemask_ps(_mm_castsi128_ps(v_lane_ok));
+				if (survivors == 0) break;
+			}
+			for (int lane = 0; lane < 4; ++lane) {
+				if (survivors & (1 << lane)) candidates.push_back(x + lane);
+			}
+		}
+		ScanRow_Scalar(screen, profile, y, x, x_end, tolerance, candidates);
+	}
+#endif
+
+	inline ScanRowFn SelectScanRow() {
+#ifdef _WIN64
+		if (g_is_avx512_supported.load(std::memory_order_relaxed)) return ScanRow_AVX512;
+		if (g_is_avx2_supported.load(std::memory_order_relaxed)) return ScanRow_AVX2;
+#else
+		if (g_is_sse2_supported.load(std::memory_order_relaxed)) return ScanRow_SSE2;
+#endif
+		return ScanRow_Scalar;
+	}
+}
+
+// ============================================================================
+// MULTI-CANDIDATE KERNELS: Narrow templates
+// ============================================================================
+// Description:
+//   The per-position kernels vectorize along a template row, which leaves
+//   most lanes idle for templates narrower than a register (checkboxes,
+//   status dots) and re-enters the kernel once per x. These kernels instead
+//   test N adjacent positions at once: each opaque template pixel is
+//   broadcast and compared with N consecutive source pixels, and a per-lane
+//   survivor mask shrinks until it is empty or the template is exhausted.
+//
+// Notes:
+//   - N = 16 (AVX512), 8 (AVX2), 4 (SSE2)
+//   - Caller guarantees start_x + N - 1 is a valid position
+//   - Returns the mask of matching positions (bit i = start_x + i)
+// ============================================================================
+#define MULTI_CANDIDATE_MAX_WIDTH 16
+
+namespace MultiCandidate {
+	using MatchBlockFn = uint32_t(*)(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance);
+
+#ifdef _WIN64
+	inline uint32_t MatchBlock_AVX2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+		const __m256i v_zero = _mm256_setzero_si256();
+
+		uint32_t survivors = 0xFF;
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+
+			for (int x = 0; x < source.width; ++x) {
+				COLORREF source_pixel = source_row[x];
+				if (transparent_enabled && static_cast<int>(source_pixel >> 24) < alpha_threshold) continue;
+
+				__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_row + x));
+				__m256i v_source = _mm256_set1_epi32(static_cast<int>(source_pixel));
+				__m256i v_abs_diff = _mm256_or_si256(_mm256_subs_epu8(v_screen, v_source), _mm256_subs_epu8(v_source, v_screen));
+				__m256i v_exceed = _mm256_and_si256(_mm256_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+				__m256i v_lane_ok = _mm256_cmpeq_epi32(v_exceed, v_zero);
+				survivors &= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(v_lane_ok)));
+				if (survivors == 0) return 0;
+			}
+		}
+		return survivors;
+	}
+
+	inline uint32_t MatchBlock_AVX512(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+		const __m512i v_rgb_mask = _mm512_set1_epi32(0x00FFFFFF);
+		const __m512i v_tolerance8 = _mm512_set1_epi8(static_cast<char>(tolerance));
+
+		__mmask16 survivors = 0xFFFF;
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+
+			for (int x = 0; x < source.width; ++x) {
+				COLORREF source_pixel = source_row[x];
+				if (transparent_enabled && static_cast<int>(source_pixel >> 24) < alpha_threshold) continue;
+
+				__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(screen_row + x));
+				__m512i v_source = _mm512_set1_epi32(static_cast<int>(source_pixel));
+				__m512i v_abs_diff = _mm512_or_si512(_mm512_subs_epu8(v_screen, v_source), _mm512_subs_epu8(v_source, v_screen));
+				__m512i v_exceed = _mm512_subs_epu8(v_abs_diff, v_tolerance8);
+				survivors &= _mm512_testn_epi32_mask(v_exceed, v_rgb_mask);
+				if (survivors == 0) return 0;
+			}
+		}
+		return survivors;
+	}
+#else
+	inline uint32_t MatchBlock_SSE2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, bool transparent_enabled, int tolerance) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+		const __m128i v_rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i v_tolerance8 = _mm_set1_epi8(static_cast<char>(tolerance));
+		const __m128i v_zero = _mm_setzero_si128();
+
+		uint32_t survivors = 0xF;
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+
+			for (int x = 0; x < source.width; ++x) {
+				COLORREF source_pixel = source_row[x];
+				if (transparent_enabled && static_cast<int>(source_pixel >> 24) < alpha_threshold) continue;
+
+				__m128i v_screen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen_row + x));
+				__m128i v_source = _mm_set1_epi32(static_cast<int>(source_pixel));
+				__m128i v_abs_diff = _mm_or_si128(_mm_subs_epu8(v_screen, v_source), _mm_subs_epu8(v_source, v_screen));
+				__m128i v_exceed = _mm_and_si128(_mm_subs_epu8(v_abs_diff, v_tolerance8), v_rgb_mask);
+				__m128i v_lane_ok = _mm_cmpeq_epi32(v_exceed, v_zero);
+				survivors &= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(v_lane_ok)));
+				if (survivors == 0) return 0;
+			}
+		}
+		return survivors;
+	}
+#endif
+
+	// Selects the widest block kernel; lanes receives N (0 = no kernel)
+	inline MatchBlockFn SelectMatchBlock(int& lanes) {
+#ifdef _WIN64
+		if (g_is_avx512_supported.load(std::memory_order_relaxed)) { lanes = 16; return MatchBlock_AVX512; }
+		if (g_is_avx2_supported.load(std::memory_order_relaxed)) { lanes = 8; return MatchBlock_AVX2; }
+#else
+		if (g_is_sse2_supported.load(std::memory_order_relaxed)) { lanes = 4; return MatchBlock_SSE2; }
+#endif
+		lanes = 0;
+		return nullptr;
+	}
+}
+
+// ============================================================================
+// SOURCE ANALYSIS: Per-frame artifacts shared by all targets
+// ============================================================================
+// Description:
+//   Built lazily from the source frame of one UnifiedImageSearch call and
+//   passed to every SearchForBitmap call of that search (all targets, all
+//   scales). Builders are thread-safe since scales are searched concurrently.
+//
+// Pyramid Levels:
+//   2x/4x/8x box-downsampled copies of the source for coarse-to-fine search,
+//   each with its own SourceAnalysis (levels never build further levels).
+//
+// Summed-Area Tables:
+//   One table per channel, (width + 1) x (height + 1), accumulated modulo
+//   2^32. A window sum is four lookups; wrap-around cancels out as long as
+//   the true window sum stays below 2^32 (area * 255 < 2^32). Costs 12 bytes
+//   per source pixel, so sources above INTEGRAL_MAX_SOURCE_PIXELS skip the
+//   tables, and a failed allocation leaves them disabled rather than
+//   throwing. SearchForBitmap only asks for them once enough anchor
+//   candidates reach the kernel (MEAN_FILTER_CANDIDATE_RATIO).
+// ============================================================================
+#ifdef _WIN64
+#define INTEGRAL_MAX_SOURCE_PIXELS 8500000         // A 4K frame, about 100 MB of tables
+#else
+#define INTEGRAL_MAX_SOURCE_PIXELS 2100000         // A 1080p frame, about 25 MB of tables
+#endif
+#define MEAN_FILTER_MIN_AREA 64
+#define MEAN_FILTER_CANDIDATE_RATIO 32             // Build after source pixels / 32 kernel calls
+#define MAX_PYRAMID_LEVELS 3
+#define PYRAMID_MIN_TEMPLATE 32
+#define PYRAMID_MAX_TOLERANCE 128
+
+// ============================================================================
+// HELPER: DownsampleBox
+// ============================================================================
+// Description:
+//   Averages factor x factor blocks (rounded to nearest) whose grid starts at
+//   (phase_x, phase_y); partial blocks at the right/bottom edge are dropped.
+//   When alpha_threshold > 0, a block containing any pixel with alpha below
+//   it becomes fully transparent (alpha 0), otherwise blocks are opaque.
+// ============================================================================
+PixelBuffer DownsampleBox(const PixelBuffer& src, int factor, int phase_x, int phase_y, int alpha_threshold) {
+	PixelBuffer dst;
+	dst.width = (src.width - phase_x) / factor;
+	dst.height = (src.height - phase_y) / factor;
+	if (dst.width <= 0 || dst.height <= 0) {
+		dst.width = dst.height = 0;
+		return dst;
+	}
+	dst.has_alpha = alpha_threshold > 0;
+	dst.pixels = g_pixel_pool.Acquire(static_cast<size_t>(dst.width) * dst.height);
+	dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height);
+
+	const uint32_t count = static_cast<uint32_t>(factor * factor);
+	std::vector<uint32_t> sums(static_cast<size_t>(dst.width) * 3);
+	std::vector<uint8_t> transparent(dst.width);
+
+	for (int by = 0; by < dst.height; ++by) {
+		std::fill(sums.begin(), sums.end(), 0);
+		std::fill(transparent.begin(), transparent.end(), 0);
+		for (int j = 0; j < factor; ++j) {
+			const COLORREF* row = &src.pixels[(phase_y + by * factor + j) * src.width + phase_x];
+			for (int bx = 0; bx < dst.width; ++bx) {
+				for (int i = 0; i < factor; ++i) {
+					COLORREF pixel = row[bx * factor + i];
+					sums[bx * 3 + 0] += GetRValue(pixel);
+					sums[bx * 3 + 1] += GetGValue(pixel);
+					sums[bx * 3 + 2] += GetBValue(pixel);
+					if (static_cast<int>((pixel >> 24) & 0xFF) < alpha_threshold) transparent[bx] = 1;
+				}
+			}
+		}
+		COLORREF* out = &dst.pixels[by * dst.width];
+		for (int bx = 0; bx < dst.width; ++bx) {
+			uint32_t r = (sums[bx * 3 + 0] + count / 2) / count;
+			uint32_t g = (sums[bx * 3 + 1] + count / 2) / count;
+			uint32_t b = (sums[bx * 3 + 2] + count / 2) / count;
+			uint32_t a = transparent[bx] ? 0 : 255;
+			out[bx] = (a << 24) | (b << 16) | (g << 8) | r;
+		}
+	}
+	return dst;
+}
+
+class SourceAnalysis {
+public:
+	explicit SourceAnalysis(const PixelBuffer& source, bool is_pyramid_level = false)
+		: m_source(source), m_is_pyramid_level(is_pyramid_level) {
+	}
+
+	SourceAnalysis(const SourceAnalysis&) = delete;
+	SourceAnalysis& operator=(const SourceAnalysis&) = delete;
+
+	const PixelBuffer& Source() const noexcept { return m_source; }
+	bool IsPyramidLevel() const noexcept { return m_is_pyramid_level; }
+
+	// Box-averaged copy of the source at 1/factor resolution (factor 2, 4 or 8),
+	// with its own analysis. Levels are built directly from full resolution so
+	// every level pixel is a correctly rounded block mean.
+	SourceAnalysis* Downsampled(int factor) {
+		int index = (factor == 2) ? 0 : (factor == 4) ? 1 : (factor == 8) ? 2 : -1;
+		if (index < 0 || m_is_pyramid_level) return nullptr;
+
+		std::lock_guard<std::mutex> lock(m_levels_mutex);
+		if (!m_levels[index]) {
+			auto level = std::make_unique<PyramidLevel>();
+			level->buffer = DownsampleBox(m_source, factor, 0, 0, 0);
+			if (!level->buffer.IsValid()) return nullptr;
+			level->analysis = std::make_unique<SourceAnalysis>(level->buffer, true);
+			m_levels[index] = std::move(level);
+		}
+		return m_levels[index]->analysis.get();
+	}
+
+	bool EnsureIntegral() {
+		std::call_once(m_integral_once, [this]() { BuildIntegral(); });
+		return m_integral_ready;
+	}
+
+	// Sum of channel c (0 = R, 1 = G, 2 = B) over a window; requires EnsureIntegral()
+	uint32_t WindowSum(int c, int x, int y, int w, int h) const noexcept {
+		const size_t stride = static_cast<size_t>(m_source.width) + 1;
+		const uint32_t* t = m_integral[c].data();
+		return t[(y + h) * stride + x + w] - t[y * stride + x + w] - t[(y + h) * stride + x] + t[y * stride + x];
+	}
+
+private:
+	void BuildIntegral() {
+		if (m_source.pixels.size() > INTEGRAL_MAX_SOURCE_PIXELS) return;
+		const size_t stride = static_cast<size_t>(m_source.width) + 1;
+		try {
+			for (auto& table : m_integral) {
+				table.assign(stride * (static_cast<size_t>(m_source.height) + 1), 0);
+			}
+		}
+		catch (const std::bad_alloc&) {
+			for (auto& table : m_integral) std::vector<uint32_t>().swap(table);
+			return;
+		}
+		for (int y = 0; y < m_source.height; ++y) {
+			const COLORREF* row = &m_source.pixels[y * m_source.width];
+			uint32_t run[3] = { 0, 0, 0 };
+			for (int x = 0; x < m_source.width; ++x) {
+				run[0] += GetRValue(row[x]);
+				run[1] += GetGValue(row[x]);
+				run[2] += GetBValue(row[x]);
+				for (int c = 0; c < 3; ++c) {
+					m_integral[c][(y + 1) * stride + x + 1] = m_integral[c][y * stride + x + 1] + run[c];
 				}
 			}
 		}
+		m_integral_ready = true;
+	}
+
+	struct PyramidLevel {
+		PixelBuffer buffer;
+		std::unique_ptr<SourceAnalysis> analysis;
+	};
+
+	const PixelBuffer& m_source;
+	const bool m_is_pyramid_level;
+	std::once_flag m_integral_once;
+	std::vector<uint32_t> m_integral[3];
+	bool m_integral_ready = false;
+	std::mutex m_levels_mutex;
+	std::unique_ptr<PyramidLevel> m_levels[MAX_PYRAMID_LEVELS];
+};
+
+// ============================================================================
+// EXACT MATCH ENGINE: 2D rolling hash (tolerance 0)
+// ============================================================================
+// Description:
+//   Rabin-Karp in two dimensions. Every source row gets a rolling horizontal
+//   hash over the width of the template's opaque rectangle, and those row
+//   hashes are rolled vertically over its height, so each candidate position
+//   costs O(1) no matter how large the template is. Only positions whose hash
+//   equals the template hash are confirmed with the full kernel, which also
+//   checks opaque pixels outside the rectangle and ignores transparent ones.
+//
+// Notes:
+//   - Hashes use the RGB bits only; alpha never takes part in a comparison
+//   - Arithmetic is modulo 2^64; collisions only cost a kernel call
+//   - Hits are reported in scan order; on_hit returns false to stop
+//   - Scan covers one band of rows and primes its own vertical window, so
+//     bands run independently on the pool. The row leaving the window is
+//     rehashed instead of kept, which holds memory to three lines per band.
+// ============================================================================
+#define EXACT_HASH_MIN_AREA 16
+
+namespace ExactMatch {
+	constexpr uint64_t kRowBase = 0x100000001B3ULL;
+	constexpr uint64_t kColBase = 0x9E3779B97F4A7C15ULL;
+
+	inline uint64_t PixelKey(COLORREF pixel) noexcept {
+		return static_cast<uint64_t>(pixel & 0x00FFFFFF) + 1;
+	}
+
+	inline uint64_t Power(uint64_t base, int exponent) noexcept {
+		uint64_t result = 1;
+		for (int i = 0; i < exponent; ++i) result *= base;
+		return result;
+	}
+
+	// Positions of rows [y_begin, y_stop)
+	template<typename OnHit>
+	void Scan(const PixelBuffer& Source, const PixelBuffer& Target, const TemplateProfile& profile,
+		int y_begin, int y_stop, OnHit on_hit) {
+		const int rw = profile.opaque_w, rh = profile.opaque_h;
+		const int ox = profile.opaque_x, oy = profile.opaque_y;
+		const int ncols = Source.width - Target.width + 1;
+		y_stop = std::min(y_stop, Source.height - Target.height + 1);
+		if (rw <= 0 || rh <= 0 || ncols <= 0 || y_begin < 0 || y_begin >= y_stop) return;
+
+		const uint64_t row_power = Power(kRowBase, rw);
+		const uint64_t col_power = Power(kColBase, rh);
+
+		uint64_t target_hash = 0;
+		for (int j = 0; j < rh; ++j) {
+			const COLORREF* row = &Target.pixels[(oy + j) * Target.width + ox];
+			uint64_t h = 0;
+			for (int i = 0; i < rw; ++i) h = h * kRowBase + PixelKey(row[i]);
+			target_hash = target_hash * kColBase + h;
+		}
+
+		auto HashRow = [&](int sy, uint64_t* out) {
+			const COLORREF* row = &Source.pixels[sy * Source.width + ox];
+			uint64_t h = 0;
+			for (int i = 0; i < rw; ++i) h = h * kRowBase + PixelKey(row[i]);
+			out[0] = h;
+			for (int x = 1; x < ncols; ++x) {
+				h = h * kRowBase - PixelKey(row[x - 1]) * row_power + PixelKey(row[x - 1 + rw]);
+				out[x] = h;
+			}
+			};
+
+		std::vector<uint64_t> window(ncols, 0);
+		std::vector<uint64_t> incoming(ncols);
+		std::vector<uint64_t> outgoing(ncols);
+
+		for (int j = 0; j < rh; ++j) {
+			HashRow(oy + y_begin + j, incoming.data());
+			for (int x = 0; x < ncols; ++x) window[x] = window[x] * kColBase + incoming[x];
+		}
+
+		for (int y = y_begin; y < y_stop; ++y) {
+			for (int x = 0; x < ncols; ++x) {
+				if (window[x] == target_hash && !on_hit(x, y)) return;
+			}
+			if (y + 1 >= y_stop) break;
+
+			HashRow(oy + y, outgoing.data());
+			HashRow(oy + y + rh, incoming.data());
+			for (int x = 0; x < ncols; ++x) {
+				window[x] = window[x] * kColBase - outgoing[x] * col_power + incoming[x];
+			}
+		}
+	}
+}
+
+// Name of the widest SIMD backend the kernels will use on this CPU
+inline const wchar_t* SimdBackendName() {
+#ifdef _WIN64
+	if (g_is_avx512_supported.load(std::memory_order_relaxed)) return L"AVX512";
+	if (g_is_avx2_supported.load(std::memory_order_relaxed)) return L"AVX2";
+#else
+	if (g_is_sse2_supported.load(std::memory_order_relaxed)) return L"SSE2";
+#endif
+	return L"Scalar";
+}
+
+// ============================================================================
+// HELPER FUNCTION: CompareMatchResults
+// ============================================================================
+// Description:
+//   Comparison function for sorting match results in top-to-bottom, left-to-right order.
+//   Used by std::sort to organize multiple matches into a consistent order.
+// ============================================================================
+bool CompareMatchResults(const MatchResult& a, const MatchResult& b) {
+	if (a.y != b.y) return a.y < b.y;  // Sort by Y first (top to bottom)
+	return a.x < b.x;                  // Then by X (left to right)
+}
+
+// ============================================================================
+// THREAD POOL: Process-wide workers for all parallel paths
+// ============================================================================
+// Description:
+//   One lazily created pool shared by target decoding, the scale loop, tile
+//   scanning and the multi-template engine, so nested parallel work reuses
+//   a fixed set of threads instead of spawning scales x cores threads.
+//
+// Notes:
+//   - Bounded queue: when full, Submit runs the task on the caller
+//   - Await() runs queued tasks while waiting, so nested submits from pool
+//     threads cannot deadlock the pool
+//   - Workers pin the DLL while alive and exit (releasing it) after being
+//     idle for POOL_IDLE_TIMEOUT_MS, so FreeLibrary never unloads code a
+//     worker is still parked in
+// ============================================================================
+#define POOL_QUEUE_CAPACITY 256
+#define POOL_IDLE_TIMEOUT_MS 30000
+
+class ThreadPool {
+public:
+	static ThreadPool& Instance() {
+		static ThreadPool* pool = new ThreadPool();  // Never destroyed: workers may outlive static teardown
+		return *pool;
+	}
+
+	// Threads that can run tasks at once (workers plus the awaiting caller)
+	unsigned int Concurrency() const { return m_max_workers + 1; }
+
+	template<typename F>
+	auto Submit(F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+		using R = std::invoke_result_t<std::decay_t<F>>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+		std::future<R> result = task->get_future();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_queue.size() >= POOL_QUEUE_CAPACITY) {
+			lock.unlock();
+			(*task)();
+			return result;
+		}
+		m_queue.emplace_back([task]() { (*task)(); });
+		// Idle workers that were notified but have not woken yet still count
+		// as idle, so grow whenever queued tasks outnumber them
+		if (m_queue.size() > m_idle_workers && m_live_workers < m_max_workers) {
+			SpawnWorker();
+		}
+		lock.unlock();
+		m_cv.notify_one();
+		return result;
+	}
+
+	// Runs worker(t) for t in [0, num_threads); worker 0 runs on the calling
+	// thread. Results of workers that threw are dropped.
+	template<typename W>
+	auto RunWorkers(unsigned int num_threads, W&& worker) {
+		using Result = decltype(worker(0));
+		std::vector<std::future<Result>> futures;
+		for (unsigned int t = 1; t < num_threads; ++t) {
+			futures.push_back(Submit([&worker, t]() { return worker(static_cast<int>(t)); }));
+		}
+		std::vector<Result> results;
+		results.push_back(worker(0));
+		for (auto& fut : futures) {
+			try {
+				results.push_back(Await(fut));
+			}
+			catch (const std::exception&) {
+			}
+		}
+		return results;
+	}
+
+	template<typename T>
+	T Await(std::future<T>& fut) {
+		for (;;) {
+			std::future_status status = fut.wait_for(std::chrono::seconds(0));
+			if (status != std::future_status::timeout) break;
+			if (!RunOneTask()) {
+				fut.wait();
+				break;
+			}
+		}
+		return fut.get();
+	}
+
+private:
+	ThreadPool() : m_max_workers(std::max(1u, std::thread::hardware_concurrency()) - 1) {
+		if (m_max_workers == 0) m_max_workers = 1;
+	}
+
+	bool RunOneTask() {
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_queue.empty()) return false;
+			task = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+		task();
 		return true;
 	}
-#endif
+
+	// Called with m_mutex held
+	void SpawnWorker() {
+		HMODULE module = nullptr;
+		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+			reinterpret_cast<LPCWSTR>(&ThreadPool::WorkerMain), &module)) {
+			return;  // Awaiting callers still drain the queue
+		}
+		HANDLE thread = CreateThread(nullptr, 0, &ThreadPool::WorkerMain, module, 0, nullptr);
+		if (!thread) {
+			FreeLibrary(module);
+			return;
+		}
+		CloseHandle(thread);
+		++m_live_workers;
+	}
+
+	static DWORD WINAPI WorkerMain(LPVOID param) {
+		Instance().WorkerLoop();
+		FreeLibraryAndExitThread(static_cast<HMODULE>(param), 0);
+		return 0;
+	}
+
+	void WorkerLoop() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;) {
+			++m_idle_workers;
+			bool has_task = m_cv.wait_for(lock, std::chrono::milliseconds(POOL_IDLE_TIMEOUT_MS),
+				[this]() { return !m_queue.empty(); });
+			--m_idle_workers;
+			if (!has_task) {
+				--m_live_workers;
+				return;
+			}
+
+			std::function<void()> task = std::move(m_queue.front());
+			m_queue.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_queue;
+	unsigned int m_max_workers;
+	unsigned int m_live_workers = 0;
+	unsigned int m_idle_workers = 0;
+};
+
+// ============================================================================
+// WORK-STEALING TILE SCHEDULER
+// ============================================================================
+// Description:
+//   Hands out tile indices to a fixed set of workers. Each worker owns a
+//   contiguous range of tiles packed into one atomic (begin | end << 32) and
+//   takes tiles from its front; an idle worker steals the back half of
+//   another worker's range. Slow regions (dense UI with many near-misses)
+//   therefore no longer leave the other cores idle.
+//
+// Notes:
+//   - Every tile is handed out exactly once
+//   - Next() returns -1 once no range holds work
+// ============================================================================
+#define TILE_ROWS 32
+#define TILE_L2_BYTES (256 * 1024)
+#define PARALLEL_MIN_POSITIONS (1 << 18)
+
+class TileScheduler {
+public:
+	TileScheduler(int tile_count, int workers)
+		: m_workers(workers), m_ranges(std::make_unique<Range[]>(workers)) {
+		for (int w = 0; w < workers; ++w) {
+			uint32_t begin = static_cast<uint32_t>(static_cast<int64_t>(tile_count) * w / workers);
+			uint32_t end = static_cast<uint32_t>(static_cast<int64_t>(tile_count) * (w + 1) / workers);
+			m_ranges[w].bounds.store(Pack(begin, end), std::memory_order_relaxed);
+		}
+	}
+
+	int Next(int worker) {
+		std::atomic<uint64_t>& own = m_ranges[worker].bounds;
+		for (;;) {
+			uint64_t current = own.load(std::memory_order_acquire);
+			uint32_t begin = Begin(current), end = End(current);
+			if (begin < end) {
+				if (own.compare_exchange_weak(current, Pack(begin + 1, end), std::memory_order_acq_rel)) {
+					return static_cast<int>(begin);
+				}
+				continue;
+			}
+
+			bool work_left = false;
+			for (int k = 1; k < m_workers; ++k) {
+				std::atomic<uint64_t>& victim = m_ranges[(worker + k) % m_workers].bounds;
+				uint64_t observed = victim.load(std::memory_order_acquire);
+				uint32_t v_begin = Begin(observed), v_end = End(observed);
+				if (v_begin >= v_end) continue;
+				work_left = true;
+
+				uint32_t split = v_end - (v_end - v_begin + 1) / 2;
+				if (victim.compare_exchange_strong(observed, Pack(v_begin, split), std::memory_order_acq_rel)) {
+					own.store(Pack(split + 1, v_end), std::memory_order_release);
+					return static_cast<int>(split);
+				}
+			}
+			if (!work_left) return -1;
+		}
+	}
+
+private:
+	struct alignas(64) Range {
+		std::atomic<uint64_t> bounds{ 0 };
+	};
+
+	static uint64_t Pack(uint32_t begin, uint32_t end) { return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32); }
+	static uint32_t Begin(uint64_t bounds) { return static_cast<uint32_t>(bounds); }
+	static uint32_t End(uint64_t bounds) { return static_cast<uint32_t>(bounds >> 32); }
+
+	int m_workers;
+	std::unique_ptr<Range[]> m_ranges;
+};
+
+// ============================================================================
+// RESULT BUDGET: Completed-prefix cancellation
+// ============================================================================
+// Description:
+//   Units of work (tile rows, scales) produce matches that are consumed in
+//   unit order. Once the leading run of completed units holds `budget`
+//   matches, no later unit can contribute to the first `budget` results, so
+//   workers skip every unit past that prefix. A budget <= 0 never cancels.
+// ============================================================================
+class PrefixBudget {
+public:
+	PrefixBudget(int units, int parts_per_unit, int budget)
+		: m_budget(budget), m_remaining(units, parts_per_unit), m_matches(units, 0),
+		m_cutoff(budget > 0 ? units : INT_MAX) {
+	}
+
+	bool IsNeeded(int unit) const { return unit <= m_cutoff.load(std::memory_order_acquire); }
+
+	// Records one finished part of a unit and the matches it produced
+	void Complete(int unit, size_t matches) {
+		if (m_budget <= 0) return;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_matches[unit] += matches;
+		--m_remaining[unit];
+		while (m_prefix < static_cast<int>(m_remaining.size()) && m_remaining[m_prefix] == 0) {
+			m_prefix_matches += m_matches[m_prefix];
+			++m_prefix;
+			if (m_prefix_matches >= static_cast<size_t>(m_budget)) {
+				m_cutoff.store(m_prefix - 1, std::memory_order_release);
+				break;
+			}
+		}
+	}
+
+private:
+	int m_budget;
+	std::mutex m_mutex;
+	std::vector<int> m_remaining;
+	std::vector<size_t> m_matches;
+	int m_prefix = 0;
+	size_t m_prefix_matches = 0;
+	std::atomic<int> m_cutoff;
+};
+
+// ============================================================================
+// NON-OVERLAP: Occupancy map of claimed positions
+// ============================================================================
+// Description:
+//   In non-overlapping mode a hit at (x, y) claims every later position in
+//   scan order whose w x h window would intersect it: columns x-w+1..x+w-1
+//   of rows y..y+h-1. One bit per position; runs of free positions are found
+//   a 64-bit word at a time so claimed spans are never compared at all.
+// ============================================================================
+class OccupancyMap {
+public:
+	OccupancyMap(int width, int height, int cover_w, int cover_h)
+		: m_width(width), m_height(height), m_words((width + 63) / 64),
+		m_cover_w(cover_w), m_cover_h(cover_h),
+		m_bits(static_cast<size_t>(m_words) * height, 0) {
+	}
+
+	bool IsSet(int x, int y) const {
+		return (m_bits[static_cast<size_t>(y) * m_words + (x >> 6)] >> (x & 63)) & 1;
+	}
+
+	// First free / claimed position of row y in [x, x_stop), or x_stop
+	int NextFree(int y, int x, int x_stop) const { return Find(y, x, x_stop, false); }
+	int NextSet(int y, int x, int x_stop) const { return Find(y, x, x_stop, true); }
+
+	void Mark(int x, int y) {
+		const int x0 = std::max(0, x - m_cover_w + 1);
+		const int x1 = std::min(m_width, x + m_cover_w);
+		const int y1 = std::min(m_height, y + m_cover_h);
+		for (int row = y; row < y1; ++row) {
+			uint64_t* bits = &m_bits[static_cast<size_t>(row) * m_words];
+			for (int i = x0; i < x1;) {
+				const int bit = i & 63;
+				const int count = std::min(64 - bit, x1 - i);
+				bits[i >> 6] |= (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << bit;
+				i += count;
+			}
+		}
+	}
+
+	// Claims (x, y) unless an earlier hit already covers it
+	bool TryClaim(int x, int y) {
+		if (IsSet(x, y)) return false;
+		Mark(x, y);
+		return true;
+	}
+
+private:
+	int Find(int y, int x, int x_stop, bool set) const {
+		const uint64_t* bits = &m_bits[static_cast<size_t>(y) * m_words];
+		while (x < x_stop) {
+			uint64_t word = set ? bits[x >> 6] : ~bits[x >> 6];
+			word >>= (x & 63);
+			if (word) return std::min(x_stop, x + std::countr_zero(word));
+			x = (x | 63) + 1;
+		}
+		return x_stop;
+	}
+
+	int m_width, m_height, m_words;
+	int m_cover_w, m_cover_h;
+	std::vector<uint64_t> m_bits;
+};
+
+// Keeps the matches of one template (in scan order) that no earlier kept match overlaps
+void SuppressOverlapsInScanOrder(std::vector<MatchResult>& matches, int search_left, int search_top,
+	int positions_w, int positions_h) {
+	if (matches.size() < 2) return;
+	OccupancyMap occupancy(positions_w, positions_h, matches[0].w, matches[0].h);
+	auto kept = std::remove_if(matches.begin(), matches.end(), [&](const MatchResult& m) {
+		return !occupancy.TryClaim(m.x - search_left, m.y - search_top);
+		});
+	matches.erase(kept, matches.end());
 }
 
-// ============================================================================
-// HELPER FUNCTION: CompareMatchResults
-// ============================================================================
-// Description:
-//   Comparison function for sorting match results in top-to-bottom, left-to-right order.
-//   Used by std::sort to organize multiple matches into a consistent order.
-// ============================================================================
-bool CompareMatchResults(const MatchResult& a, const MatchResult& b) {
-	if (a.y != b.y) return a.y < b.y;  // Sort by Y first (top to bottom)
-	return a.x < b.x;                  // Then by X (left to right)
+// Greedy suppression across templates of different sizes: a match is dropped
+// when it intersects one kept before it, so earlier entries take priority
+void SuppressOverlaps(std::vector<MatchResult>& matches) {
+	std::vector<MatchResult> kept;
+	for (auto& m : matches) {
+		bool overlaps = std::any_of(kept.begin(), kept.end(), [&](const MatchResult& k) {
+			return m.x < k.x + k.w && k.x < m.x + m.w && m.y < k.y + k.h && k.y < m.y + m.h;
+			});
+		if (!overlaps) kept.push_back(std::move(m));
+	}
+	matches = std::move(kept);
 }
 
 // ============================================================================
@@ -1520,15 +4249,21 @@ bool CompareMatchResults(const MatchResult& a, const MatchResult& b) {
 //
 // Algorithm:
 //   1. Detect CPU capabilities and select fastest SIMD backend
-//   2. For large images (>500px height) and find_all mode, use multi-threading
-//   3. Scan source image row-by-row, column-by-column
-//   4. For each position, call SIMD-optimized pixel comparison
-//   5. Collect all matches or stop at first match based on find_all flag
+//   2. Prepare the template profile (anchor pixels)
+//   3. For large searches, scan 2D tiles on all cores
+//   4. Scan source image row-by-row; anchor scan yields the row's candidates
+//   5. For each candidate, call SIMD-optimized pixel comparison
+//   6. Collect all matches or stop at first match based on find_all flag
 //
 // Performance Optimizations:
 //   - SIMD instructions process 8-16 pixels simultaneously
-//   - Multi-threading divides work across CPU cores
-//   - Early-exit on first match when find_all=false
+//   - Anchor prefilter rejects most positions touching one pixel each
+//   - Templates < 16px wide test 4/8/16 adjacent positions per kernel call
+//   - Tolerance 0 uses a 2D rolling hash (O(1) per position)
+//   - Summed-area tables reject windows whose mean color is out of range
+//   - Templates >= 32px are matched coarse-to-fine on a 2x/4x pyramid
+//   - Work-stealing tile scheduler balances work across CPU cores
+//   - Early-exit on first match when find_all=false (serial or parallel)
 //   - Cache-friendly row-wise scanning
 //
 // Parameters:
@@ -1541,6 +4276,11 @@ bool CompareMatchResults(const MatchResult& a, const MatchResult& b) {
 //   scale_factor     - Scale factor of current search (for reporting)
 //   source_file      - Image filename (for debugging)
 //   backend_used     - Output: SIMD backend actually used
+//   analysis         - Optional per-frame tables shared across targets/scales
+//   max_results      - find_all only: stop once the first max_results matches
+//                      in scan order are certain (0 = unlimited)
+//   non_overlapping  - find_all only: skip positions whose window overlaps an
+//                      earlier match in scan order
 //
 // Returns:
 //   Vector of MatchResult containing all found positions
@@ -1549,122 +4289,919 @@ std::vector<MatchResult> SearchForBitmap(
 	const PixelBuffer& Source, const PixelBuffer& Target,
 	int search_left, int search_top, int tolerance, bool transparent_enabled,
 	bool find_all, float scale_factor, const std::wstring& source_file,
-	std::wstring& backend_used) {
+	std::wstring& backend_used, SourceAnalysis* analysis = nullptr, int max_results = 0,
+	bool non_overlapping = false) {
 
 	std::vector<MatchResult> matches;
 	if (Target.width > Source.width || Target.height > Source.height) return matches;
 
+	// Matches wanted, in scan order
+	const size_t result_limit = !find_all ? 1 : (max_results > 0 ? static_cast<size_t>(max_results) : SIZE_MAX);
+
 	backend_used = L"Scalar";
 
-	auto CheckMatch = [&](int x, int y) -> bool {
-#ifdef _WIN64
-		if (g_is_avx512_supported.load(std::memory_order_relaxed)) {
-			return PixelComparison::CheckApproxMatch_AVX512(Source, Target, x, y, transparent_enabled, tolerance);
+	const TemplateProfile profile = BuildTemplateProfile(Target, transparent_enabled, tolerance);
+
+	// ========================================================================
+	// MEAN-COLOR REJECTION
+	// ========================================================================
+	// If every opaque pixel is within tolerance, so is the mean of the opaque
+	// rectangle. Windows whose channel sums differ from the template's by more
+	// than tolerance * area are rejected in O(1) from the summed-area tables.
+	// The tables cost a full pass over the frame, so they are only built once
+	// the anchor prefilter has let source pixels / MEAN_FILTER_CANDIDATE_RATIO
+	// positions through to the kernel; searches that end early never pay.
+	// ========================================================================
+	const int64_t rect_area = static_cast<int64_t>(profile.opaque_w) * profile.opaque_h;
+	const bool mean_filter_eligible = analysis && tolerance > 0 && tolerance < 255 &&
+		rect_area >= MEAN_FILTER_MIN_AREA && rect_area * 255 < (1LL << 32) &&
+		Source.pixels.size() <= INTEGRAL_MAX_SOURCE_PIXELS;
+	const int64_t mean_slack = static_cast<int64_t>(tolerance) * rect_area;
+	std::atomic<int64_t> mean_filter_countdown{ mean_filter_eligible
+		? std::max<int64_t>(1, static_cast<int64_t>(Source.pixels.size()) / MEAN_FILTER_CANDIDATE_RATIO) : 0 };
+	std::atomic<bool> use_mean_filter{ false };
+
+	auto PassesMeanFilter = [&](int x, int y) -> bool {
+		for (int c = 0; c < 3; ++c) {
+			int64_t window_sum = analysis->WindowSum(c, x + profile.opaque_x, y + profile.opaque_y,
+				profile.opaque_w, profile.opaque_h);
+			if (std::abs(window_sum - static_cast<int64_t>(profile.opaque_sum[c])) > mean_slack) return false;
 		}
-		else if (g_is_avx2_supported.load(std::memory_order_relaxed)) {
-			return PixelComparison::CheckApproxMatch_AVX2(Source, Target, x, y, transparent_enabled, tolerance);
+		return true;
+		};
+
+	// Kernel instance chosen once per search; CheckMatch is the per-position hot path
+	PixelComparison::TemplateTables kernel_tables;
+	const PixelComparison::MatchFn Match = PixelComparison::SelectMatch(Target, transparent_enabled, tolerance, kernel_tables);
+
+	auto CheckMatch = [&](int x, int y) -> bool {
+		if (use_mean_filter.load(std::memory_order_acquire)) {
+			if (!PassesMeanFilter(x, y)) return false;
 		}
-		else {
-			return PixelComparison::CheckApproxMatch_Scalar(Source, Target, x, y, transparent_enabled, tolerance);
+		else if (mean_filter_countdown.load(std::memory_order_relaxed) > 0 &&
+			mean_filter_countdown.fetch_sub(1, std::memory_order_relaxed) == 1) {
+			use_mean_filter.store(analysis->EnsureIntegral(), std::memory_order_release);
 		}
-#else
-		if (g_is_sse2_supported.load(std::memory_order_relaxed)) {
-			return PixelComparison::CheckApproxMatch_SSE2(Source, Target, x, y, transparent_enabled, tolerance);
+		return Match(Source, Target, x, y, tolerance, kernel_tables);
+		};
+
+	backend_used = SimdBackendName();
+
+	const AnchorScan::ScanRowFn ScanRow = AnchorScan::SelectScanRow();
+	const int x_end = Source.width - Target.width + 1;
+	const int y_end = Source.height - Target.height + 1;
+
+	// Non-overlapping mode claims the neighbourhood of every hit
+	std::optional<OccupancyMap> occupancy;
+	if (find_all && non_overlapping) {
+		occupancy.emplace(x_end, y_end, Target.width, Target.height);
+		backend_used += L"+NonOverlap";
+	}
+
+	// Candidate x positions of row y in [x_begin, x_stop) (all of them when there is no anchor)
+	auto CollectCandidates = [&](int y, int x_begin, int x_stop, std::vector<int>& candidates) {
+		candidates.clear();
+		if (profile.anchors.empty()) {
+			for (int x = x_begin; x < x_stop; ++x) candidates.push_back(x);
 		}
 		else {
-			return PixelComparison::CheckApproxMatch_Scalar(Source, Target, x, y, transparent_enabled, tolerance);
+			ScanRow(Source, profile, y, x_begin, x_stop, tolerance, candidates);
 		}
-#endif
 		};
 
-#ifdef _WIN64
-	if (g_is_avx512_supported.load(std::memory_order_relaxed)) {
-		backend_used = L"AVX512";
-	}
-	else if (g_is_avx2_supported.load(std::memory_order_relaxed)) {
-		backend_used = L"AVX2";
-	}
-	else {
-		backend_used = L"Scalar";
-	}
-#else
-	if (g_is_sse2_supported.load(std::memory_order_relaxed)) {
-		backend_used = L"SSE2";
-	}
-	else {
-		backend_used = L"Scalar";
-	}
-#endif
+	// Narrow templates test a block of adjacent positions per kernel call.
+	// A full match implies the anchor and mean tests, so a block starting at
+	// a candidate reports exact matches for all of its lanes.
+	int block_lanes = 0;
+	MultiCandidate::MatchBlockFn MatchBlock = nullptr;
+	if (Target.width < MULTI_CANDIDATE_MAX_WIDTH) {
+		MatchBlock = MultiCandidate::SelectMatchBlock(block_lanes);
+		if (MatchBlock) backend_used += L"+Multi" + std::to_wstring(block_lanes);
+	}
+
+	// Visits the matches of row y in [x_begin, x_stop) in ascending x;
+	// on_match returns false to stop
+	auto MatchRow = [&](int y, int x_begin, int x_stop, std::vector<int>& candidates, auto&& on_match) -> bool {
+		CollectCandidates(y, x_begin, x_stop, candidates);
+		size_t i = 0;
+		while (i < candidates.size()) {
+			const int x = candidates[i];
+			if (MatchBlock && x + block_lanes <= x_end) {
+				uint32_t hits = MatchBlock(Source, Target, x, y, transparent_enabled, tolerance);
+				if (x_stop - x < block_lanes) hits &= (1u << (x_stop - x)) - 1;
+				while (hits) {
+					unsigned long lane;
+					_BitScanForward(&lane, hits);
+					if (!on_match(x + static_cast<int>(lane))) return false;
+					hits &= hits - 1;
+				}
+				while (i < candidates.size() && candidates[i] < x + block_lanes) ++i;
+			}
+			else {
+				if (CheckMatch(x, y) && !on_match(x)) return false;
+				++i;
+			}
+		}
+		return true;
+		};
+
+	ThreadPool& pool = ThreadPool::Instance();
+
+	// Positions packed as (y << 32 | x) compare in scan order
+	auto Pack = [](int y, int x) { return (static_cast<uint64_t>(y) << 32) | static_cast<uint32_t>(x); };
 
 	// ========================================================================
-	// MULTI-THREADING OPTIMIZATION
+	// EXACT MATCH ENGINE
 	// ========================================================================
-	// For large images (>500px height) and find_all mode, split work across
-	// CPU cores for maximum performance. Each thread searches a vertical slice.
+	// With tolerance 0 a rolling hash over the template's opaque rectangle
+	// makes every position O(1); hash hits are confirmed with the kernel.
+	// Large searches split the rows into bands on the pool, each at least
+	// as tall as the rectangle so priming a band's window costs no more
+	// than scanning it. Bands follow the tile path's rules: find_all merges
+	// in scan order under a prefix budget, first match keeps an atomic best.
 	// ========================================================================
-	if (find_all && Source.height > 500) {
-		unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
-		int chunk_height = (Source.height - Target.height + 1) / num_threads;
-
-		// Don't use threading if chunks would be too small (overhead > benefit)
-		if (chunk_height < 50) {
-			num_threads = 1;
-		}
+	if (tolerance == 0 && profile.opaque_w * profile.opaque_h >= EXACT_HASH_MIN_AREA) {
+		backend_used += L"+Hash";
 
-		if (num_threads > 1) {
-			// Launch async tasks, each searching a vertical slice
-			std::vector<std::future<std::vector<MatchResult>>> futures;
+		const int band_h = std::max({ TILE_ROWS, profile.opaque_h, y_end / static_cast<int>(pool.Concurrency() * 4) });
+		const int bands = (y_end + band_h - 1) / band_h;
+		const unsigned int num_threads = std::min(pool.Concurrency(), static_cast<unsigned int>(bands));
 
-			for (unsigned int t = 0; t < num_threads; ++t) {
-				int start_y = t * chunk_height;
-				int end_y = (t == num_threads - 1) ? (Source.height - Target.height + 1) : ((t + 1) * chunk_height);
+		if (static_cast<int64_t>(x_end) * y_end >= PARALLEL_MIN_POSITIONS && num_threads > 1) {
+			if (find_all) {
+				TileScheduler scheduler(bands, static_cast<int>(num_threads));
+				PrefixBudget budget(bands, 1, occupancy ? 0 : max_results);
 
-				futures.push_back(std::async(std::launch::async, [&, start_y, end_y]() {
+				auto results = pool.RunWorkers(num_threads, [&](int worker) {
 					std::vector<MatchResult> local_matches;
-
-					for (int y = start_y; y < end_y; ++y) {
-						for (int x = 0; x <= Source.width - Target.width; ++x) {
+					for (int band = scheduler.Next(worker); band >= 0; band = scheduler.Next(worker)) {
+						if (!budget.IsNeeded(band)) continue;
+						const size_t before = local_matches.size();
+						ExactMatch::Scan(Source, Target, profile, band * band_h, (band + 1) * band_h, [&](int x, int y) {
 							if (CheckMatch(x, y)) {
 								local_matches.push_back(MatchResult(x + search_left, y + search_top,
 									Target.width, Target.height, scale_factor, source_file));
 							}
-						}
+							return true;
+							});
+						budget.Complete(band, local_matches.size() - before);
 					}
-
 					return local_matches;
-					}));
-			}
+					});
 
-			for (auto& fut : futures) {
-				try {
-					fut.wait();
-					auto local_results = fut.get();
+				for (const auto& local_results : results) {
 					matches.insert(matches.end(), local_results.begin(), local_results.end());
 				}
-				catch (const std::exception&) {
+				std::sort(matches.begin(), matches.end(), CompareMatchResults);
+				if (occupancy) SuppressOverlapsInScanOrder(matches, search_left, search_top, x_end, y_end);
+				if (matches.size() > result_limit) matches.resize(result_limit);
+				return matches;
+			}
+
+			std::atomic<uint64_t> best{ UINT64_MAX };
+			std::atomic<int> next_band{ 0 };
+
+			pool.RunWorkers(num_threads, [&](int) {
+				for (;;) {
+					const int band = next_band.fetch_add(1, std::memory_order_relaxed);
+					if (band >= bands) break;
+					// Bands are handed out in increasing y: none after this one can win
+					if (Pack(band * band_h, 0) > best.load(std::memory_order_acquire)) break;
+
+					ExactMatch::Scan(Source, Target, profile, band * band_h, (band + 1) * band_h, [&](int x, int y) {
+						const uint64_t found = Pack(y, x);
+						if (found > best.load(std::memory_order_acquire)) return false;
+						if (!CheckMatch(x, y)) return true;
+						uint64_t current = best.load(std::memory_order_relaxed);
+						while (found < current && !best.compare_exchange_weak(current, found, std::memory_order_acq_rel)) {
+						}
+						return false;
+						});
+				}
+				return 0;
+				});
+
+			const uint64_t winner = best.load();
+			if (winner != UINT64_MAX) {
+				const int y = static_cast<int>(winner >> 32);
+				const int x = static_cast<int>(winner & 0xFFFFFFFF);
+				matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+			}
+			return matches;
+		}
+
+		ExactMatch::Scan(Source, Target, profile, 0, y_end, [&](int x, int y) {
+			if (occupancy && occupancy->IsSet(x, y)) return true;
+			if (!CheckMatch(x, y)) return true;
+			if (occupancy) occupancy->Mark(x, y);
+			matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+			return matches.size() < result_limit;
+			});
+		return matches;
+	}
+
+	// ========================================================================
+	// COARSE-TO-FINE PYRAMID
+	// ========================================================================
+	// Large templates are matched first on a 1/f box-downsampled copy of the
+	// source. A full-resolution match at x lands on coarse block (x + rx) / f
+	// with rx = (-x) mod f, so the template is downsampled once per phase
+	// (rx, ry) and the f*f coarse searches together cover every position
+	// exactly once. Block means of pixels within tolerance stay within
+	// tolerance, and rounding both means adds at most 1; blocks touching a
+	// transparent pixel are ignored. Survivors are verified in scan order.
+	// ========================================================================
+	int pyramid_factor = 0;
+	if (analysis && !analysis->IsPyramidLevel() && tolerance > 0 && tolerance <= PYRAMID_MAX_TOLERANCE) {
+		int min_side = std::min(Target.width, Target.height);
+		if (min_side >= PYRAMID_MIN_TEMPLATE * 2) pyramid_factor = 4;
+		else if (min_side >= PYRAMID_MIN_TEMPLATE) pyramid_factor = 2;
+	}
+	SourceAnalysis* coarse = pyramid_factor ? analysis->Downsampled(pyramid_factor) : nullptr;
+	if (coarse) {
+		backend_used += L"+Pyramid" + std::to_wstring(pyramid_factor) + L"x";
+		const int f = pyramid_factor;
+		const int alpha_threshold = transparent_enabled ? ComputeAlphaThreshold(true, tolerance) : 0;
+
+		std::vector<std::pair<int, int>> coarse_hits;  // (y, x) at full resolution
+		for (int ry = 0; ry < f; ++ry) {
+			for (int rx = 0; rx < f; ++rx) {
+				PixelBuffer coarse_target = DownsampleBox(Target, f, rx, ry, alpha_threshold);
+				if (!coarse_target.IsValid()) continue;
+
+				std::wstring coarse_backend;
+				auto coarse_matches = SearchForBitmap(coarse->Source(), coarse_target, 0, 0, tolerance + 1,
+					transparent_enabled, true, scale_factor, source_file, coarse_backend, coarse);
+				for (const auto& m : coarse_matches) {
+					int x = m.x * f - rx;
+					int y = m.y * f - ry;
+					if (x >= 0 && y >= 0 && x < x_end && y <= Source.height - Target.height) {
+						coarse_hits.emplace_back(y, x);
+					}
 				}
 			}
+		}
+
+		std::sort(coarse_hits.begin(), coarse_hits.end());
+		for (const auto& [y, x] : coarse_hits) {
+			if (occupancy && occupancy->IsSet(x, y)) continue;
+			if (CheckMatch(x, y)) {
+				if (occupancy) occupancy->Mark(x, y);
+				matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+				if (matches.size() >= result_limit) break;
+			}
+		}
+		return matches;
+	}
+
+	// ========================================================================
+	// MULTI-THREADING OPTIMIZATION
+	// ========================================================================
+	// The candidate space is cut into 2D tiles (TILE_ROWS positions tall,
+	// wide enough that a tile's source window fits in L2). Applies to any
+	// source shape with enough positions, including wide ultrawides.
+	//   find_all:    the work-stealing scheduler balances tiles across cores
+	//   first match: tiles are taken in scan order and workers keep an atomic
+	//                best (y, x); a tile or row starting after it is skipped,
+	//                so the result equals the serial top-left-first answer
+	// ========================================================================
+	if (static_cast<int64_t>(x_end) * y_end >= PARALLEL_MIN_POSITIONS) {
+		const int tile_h = std::min(TILE_ROWS, y_end);
+		const int window_pixels = TILE_L2_BYTES / static_cast<int>(sizeof(COLORREF));
+		const int tile_w = std::min(x_end, std::max(64, window_pixels / (tile_h + Target.height) - Target.width));
+		const int tiles_x = (x_end + tile_w - 1) / tile_w;
+		const int tiles_y = (y_end + tile_h - 1) / tile_h;
+		const int tile_count = tiles_x * tiles_y;
+
+		unsigned int num_threads = std::min(pool.Concurrency(), static_cast<unsigned int>(tile_count));
+
+		if (num_threads > 1 && find_all) {
+			TileScheduler scheduler(tile_count, static_cast<int>(num_threads));
+			// Tile rows are horizontal bands, so a completed leading run of
+			// bands holds the earliest matches in scan order. Overlaps are
+			// resolved only after the merge, so raw counts cannot end the scan.
+			PrefixBudget budget(tiles_y, tiles_x, occupancy ? 0 : max_results);
+
+			auto results = pool.RunWorkers(num_threads, [&](int worker) {
+				std::vector<MatchResult> local_matches;
+				std::vector<int> candidates;
+
+				for (int tile = scheduler.Next(worker); tile >= 0; tile = scheduler.Next(worker)) {
+					const int band = tile / tiles_x;
+					if (!budget.IsNeeded(band)) continue;
+
+					const int x0 = (tile % tiles_x) * tile_w;
+					const int y0 = band * tile_h;
+					const int x1 = std::min(x0 + tile_w, x_end);
+					const int y1 = std::min(y0 + tile_h, y_end);
+					const size_t before = local_matches.size();
+					for (int y = y0; y < y1; ++y) {
+						MatchRow(y, x0, x1, candidates, [&](int x) {
+							local_matches.push_back(MatchResult(x + search_left, y + search_top,
+								Target.width, Target.height, scale_factor, source_file));
+							return true;
+							});
+					}
+					budget.Complete(band, local_matches.size() - before);
+				}
 
+				return local_matches;
+				});
+
+			for (const auto& local_results : results) {
+				matches.insert(matches.end(), local_results.begin(), local_results.end());
+			}
 			std::sort(matches.begin(), matches.end(), CompareMatchResults);
+			if (occupancy) SuppressOverlapsInScanOrder(matches, search_left, search_top, x_end, y_end);
+			if (matches.size() > result_limit) matches.resize(result_limit);
 			return matches;
 		}
-	}
 
-	for (int y = 0; y <= Source.height - Target.height; ++y) {
-		for (int x = 0; x <= Source.width - Target.width; ++x) {
-			bool found = CheckMatch(x, y);
-			if (found) {
+		if (num_threads > 1) {
+			std::atomic<uint64_t> best{ UINT64_MAX };
+			std::atomic<int> next_tile{ 0 };
+
+			pool.RunWorkers(num_threads, [&](int) {
+				std::vector<int> candidates;
+				for (;;) {
+					const int tile = next_tile.fetch_add(1, std::memory_order_relaxed);
+					if (tile >= tile_count) break;
+					const int x0 = (tile % tiles_x) * tile_w;
+					const int y0 = (tile / tiles_x) * tile_h;
+					const int x1 = std::min(x0 + tile_w, x_end);
+					const int y1 = std::min(y0 + tile_h, y_end);
+					// Tiles are handed out in increasing (y0, x0): none after this one can win
+					if (Pack(y0, x0) > best.load(std::memory_order_acquire)) break;
+
+					for (int y = y0; y < y1; ++y) {
+						if (Pack(y, x0) > best.load(std::memory_order_acquire)) break;
+						MatchRow(y, x0, x1, candidates, [&](int x) {
+							uint64_t found = Pack(y, x);
+							uint64_t current = best.load(std::memory_order_relaxed);
+							while (found < current && !best.compare_exchange_weak(current, found, std::memory_order_acq_rel)) {
+							}
+							return false;
+							});
+					}
+				}
+				return 0;
+				});
+
+			const uint64_t winner = best.load();
+			if (winner != UINT64_MAX) {
+				const int y = static_cast<int>(winner >> 32);
+				const int x = static_cast<int>(winner & 0xFFFFFFFF);
 				matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
-				if (!find_all) {
-					return matches;
+			}
+			return matches;
+		}
+	}
+
+	std::vector<int> candidates;
+	if (occupancy) {
+		// Only free runs of each row are matched; a hit ends the run it lies in
+		for (int y = 0; y < y_end; ++y) {
+			for (int x = occupancy->NextFree(y, 0, x_end); x < x_end; x = occupancy->NextFree(y, x, x_end)) {
+				const int run_end = occupancy->NextSet(y, x, x_end);
+				int hit = -1;
+				MatchRow(y, x, run_end, candidates, [&](int mx) { hit = mx; return false; });
+				if (hit < 0) {
+					x = run_end;
+					continue;
+				}
+				occupancy->Mark(hit, y);
+				matches.push_back(MatchResult(hit + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+				if (matches.size() >= result_limit) return matches;
+				x = hit + 1;
+			}
+		}
+		return matches;
+	}
+
+	for (int y = 0; y < y_end; ++y) {
+		bool keep_going = MatchRow(y, 0, x_end, candidates, [&](int x) {
+			matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+			return matches.size() < result_limit;
+			});
+		if (!keep_going) {
+			return matches;
+		}
+	}
+
+	return matches;
+}
+
+// ============================================================================
+// MULTI-TEMPLATE ENGINE: SearchForBitmaps
+// ============================================================================
+// Description:
+//   Searches several templates in one pass over the source. Each template is
+//   keyed by its rarest anchor color; every source pixel is looked up once,
+//   and a hit proposes the one position where that anchor would land. Only
+//   proposals that pass the remaining anchors reach the full kernel, so the
+//   frame streams through cache once instead of once per template.
+//
+// Algorithm:
+//   1. Key each template by anchor 0 in color buckets of size tolerance + 1;
+//      a color within tolerance lies in the same or an adjacent bucket, so
+//      the anchor is registered in all 27 neighbouring buckets
+//   2. A 64K-bit filter answers most lookups without touching the table
+//   3. Source pixels are visited in scan order, and a template's positions
+//      are a fixed offset from its key pixel, so each template's matches
+//      come out in scan order
+//   4. First-match mode: once template k matches, templates after k can no
+//      longer be the answer and are dropped; the pass ends when template 0
+//      matches or the source is exhausted
+//
+// Multi-threading:
+//   Source rows are cut into bands (at least TILE_ROWS tall) scanned on the
+//   pool, for any source shape with enough pixels.
+//     find_all:    the work-stealing scheduler hands out bands; per-band
+//                  results are concatenated in band order. With max_results,
+//                  bands past a completed prefix holding that many matches
+//                  of the first template are skipped (they cannot reach the
+//                  reported prefix).
+//     first match: bands are taken in order; each template keeps an atomic
+//                  best (y << 32 | x) and the lowest matching template
+//                  index is shared, so a band stops once it cannot beat the
+//                  current answer. The result equals the serial pass.
+//
+// Returns:
+//   One entry per target. nullopt means "not searched here" (no anchor, too
+//   large, dropped in first-match mode); the caller falls back to
+//   SearchForBitmap for those.
+// ============================================================================
+#define MULTI_TEMPLATE_MIN_TARGETS 2
+#define MULTI_TEMPLATE_FILTER_BITS 65536
+
+namespace MultiTemplate {
+	struct Entry {
+		size_t index = 0;
+		const PixelBuffer* target = nullptr;
+		bool transparent_enabled = false;
+		TemplateProfile profile;
+		PixelComparison::TemplateTables tables;
+		PixelComparison::MatchFn match = nullptr;
+	};
+
+	inline uint32_t BucketKey(int r, int g, int b) noexcept {
+		return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | static_cast<uint32_t>(b);
+	}
+
+	inline uint32_t FilterSlot(uint32_t key) noexcept {
+		return (key * 0x9E3779B1u) >> 16;
+	}
+}
+
+std::vector<std::optional<std::vector<MatchResult>>> SearchForBitmaps(
+	const PixelBuffer& Source, const std::vector<std::optional<PixelBuffer>>& Targets, size_t first_target,
+	int search_left, int search_top, int tolerance, bool find_all,
+	const std::vector<std::wstring>& source_files, std::wstring& backend_used, int max_results = 0) {
+
+	std::vector<std::optional<std::vector<MatchResult>>> results(Targets.size());
+
+	std::vector<MultiTemplate::Entry> entries;
+	for (size_t i = first_target; i < Targets.size(); ++i) {
+		if (!Targets[i] || !Targets[i]->IsValid()) continue;
+		const PixelBuffer& Target = *Targets[i];
+		if (Target.width > Source.width || Target.height > Source.height) continue;
+
+		MultiTemplate::Entry entry;
+		entry.index = i;
+		entry.target = &Target;
+		entry.transparent_enabled = Target.has_alpha;
+		entry.profile = BuildTemplateProfile(Target, entry.transparent_enabled, tolerance);
+		if (entry.profile.anchors.empty()) continue;
+		entry.match = PixelComparison::SelectMatch(Target, entry.transparent_enabled, tolerance, entry.tables);
+		entries.push_back(std::move(entry));
+	}
+	if (entries.size() < MULTI_TEMPLATE_MIN_TARGETS) return results;
+
+	backend_used = std::wstring(SimdBackendName()) + L"+MultiTemplate";
+
+	// Bucket lookup table and its presence filter
+	const int bucket_size = tolerance + 1;
+	const int bucket_max = 255 / bucket_size;
+	std::unordered_map<uint32_t, std::vector<int>> by_bucket;
+	std::vector<uint64_t> filter(MULTI_TEMPLATE_FILTER_BITS / 64, 0);
+	for (int e = 0; e < static_cast<int>(entries.size()); ++e) {
+		const COLORREF key_color = entries[e].profile.anchors[0].color;
+		const int br = GetRValue(key_color) / bucket_size;
+		const int bg = GetGValue(key_color) / bucket_size;
+		const int bb = GetBValue(key_color) / bucket_size;
+		const int reach = tolerance > 0 ? 1 : 0;
+		for (int r = std::max(0, br - reach); r <= std::min(bucket_max, br + reach); ++r) {
+			for (int g = std::max(0, bg - reach); g <= std::min(bucket_max, bg + reach); ++g) {
+				for (int b = std::max(0, bb - reach); b <= std::min(bucket_max, bb + reach); ++b) {
+					const uint32_t key = MultiTemplate::BucketKey(r, g, b);
+					by_bucket[key].push_back(e);
+					const uint32_t slot = MultiTemplate::FilterSlot(key);
+					filter[slot >> 6] |= 1ULL << (slot & 63);
+				}
+			}
+		}
+	}
+
+	// Scans source rows [row_begin, row_end) for the templates wants(e) accepts;
+	// on_match(e, x, y) returns false to stop
+	auto ScanRows = [&](int row_begin, int row_end, auto&& wants, auto&& on_match) {
+		for (int sy = row_begin; sy < row_end; ++sy) {
+			const COLORREF* row = &Source.pixels[sy * Source.width];
+			for (int sx = 0; sx < Source.width; ++sx) {
+				const COLORREF pixel = row[sx];
+				const uint32_t key = MultiTemplate::BucketKey(GetRValue(pixel) / bucket_size,
+					GetGValue(pixel) / bucket_size, GetBValue(pixel) / bucket_size);
+				const uint32_t slot = MultiTemplate::FilterSlot(key);
+				if (!(filter[slot >> 6] & (1ULL << (slot & 63)))) continue;
+
+				auto it = by_bucket.find(key);
+				if (it == by_bucket.end()) continue;
+				for (int e : it->second) {
+					if (!wants(e)) continue;
+					const MultiTemplate::Entry& entry = entries[e];
+					const AnchorPixel& key_anchor = entry.profile.anchors[0];
+					const int x = sx - key_anchor.dx;
+					const int y = sy - key_anchor.dy;
+					if (x < 0 || y < 0 || x > Source.width - entry.target->width || y > Source.height - entry.target->height) continue;
+					if (!AnchorScan::AnchorsMatchAt(Source, entry.profile, x, y, tolerance)) continue;
+					if (!entry.match(Source, *entry.target, x, y, tolerance, entry.tables)) continue;
+					if (!on_match(e, x, y)) return;
+				}
+			}
+		}
+		};
+
+	auto MakeResult = [&](int e, int x, int y) {
+		const MultiTemplate::Entry& entry = entries[e];
+		return MatchResult(x + search_left, y + search_top, entry.target->width, entry.target->height, 1.0f,
+			entry.index < source_files.size() ? source_files[entry.index] : L"");
+		};
+
+	std::vector<std::vector<MatchResult>> found(entries.size());
+
+	ThreadPool& pool = ThreadPool::Instance();
+	const int band_h = std::max(TILE_ROWS, Source.height / static_cast<int>(pool.Concurrency() * 4));
+	const int bands = (Source.height + band_h - 1) / band_h;
+	unsigned int num_threads = std::min(pool.Concurrency(), static_cast<unsigned int>(bands));
+	if (static_cast<int64_t>(Source.width) * Source.height < PARALLEL_MIN_POSITIONS) num_threads = 1;
+
+	if (find_all) {
+		// Matches of the first template decide when the reported prefix is full
+		TileScheduler scheduler(bands, static_cast<int>(num_threads));
+		PrefixBudget budget(bands, 1, max_results);
+		std::vector<std::vector<std::vector<MatchResult>>> band_found(bands);
+
+		pool.RunWorkers(num_threads, [&](int worker) {
+			for (int band = scheduler.Next(worker); band >= 0; band = scheduler.Next(worker)) {
+				if (!budget.IsNeeded(band)) continue;
+				std::vector<std::vector<MatchResult>> local(entries.size());
+				ScanRows(band * band_h, std::min((band + 1) * band_h, Source.height), [](int) { return true; },
+					[&](int e, int x, int y) {
+						local[e].push_back(MakeResult(e, x, y));
+						return true;
+					});
+				budget.Complete(band, local[0].size());
+				band_found[band] = std::move(local);
+			}
+			return 0;
+			});
+
+		// Bands cover consecutive source rows, so concatenating them keeps scan order
+		for (const auto& local : band_found) {
+			if (local.empty()) continue;
+			for (size_t e = 0; e < entries.size(); ++e) {
+				found[e].insert(found[e].end(), local[e].begin(), local[e].end());
+			}
+		}
+	}
+	else {
+		// Positions packed as (y << 32 | x) compare in scan order
+		auto Pack = [](int y, int x) { return (static_cast<uint64_t>(y) << 32) | static_cast<uint32_t>(x); };
+		std::vector<std::atomic<uint64_t>> best(entries.size());
+		for (auto& b : best) b.store(UINT64_MAX, std::memory_order_relaxed);
+		std::atomic<size_t> answer{ entries.size() };
+		std::atomic<int> next_band{ 0 };
+		const int key_dy = entries[0].profile.anchors[0].dy;
+
+		// Only the first template can be settled early: rows whose positions
+		// all lie after its best cannot change the answer
+		auto Settled = [&](int sy) {
+			return answer.load(std::memory_order_acquire) == 0 && sy - key_dy >= 0 &&
+				Pack(sy - key_dy, 0) > best[0].load(std::memory_order_acquire);
+			};
+
+		pool.RunWorkers(num_threads, [&](int) {
+			for (;;) {
+				const int band = next_band.fetch_add(1, std::memory_order_relaxed);
+				if (band >= bands) break;
+				// Bands are handed out in increasing rows: none after a settled one can win
+				const int row_begin = band * band_h;
+				const int row_end = std::min(row_begin + band_h, Source.height);
+				if (Settled(row_begin)) break;
+
+				for (int sy = row_begin; sy < row_end && !Settled(sy); ++sy) {
+					ScanRows(sy, sy + 1, [&](int e) { return static_cast<size_t>(e) <= answer.load(std::memory_order_relaxed); },
+						[&](int e, int x, int y) {
+							const uint64_t found_at = Pack(y, x);
+							uint64_t current = best[e].load(std::memory_order_relaxed);
+							while (found_at < current && !best[e].compare_exchange_weak(current, found_at, std::memory_order_acq_rel)) {
+							}
+							size_t current_answer = answer.load(std::memory_order_relaxed);
+							while (static_cast<size_t>(e) < current_answer &&
+								!answer.compare_exchange_weak(current_answer, static_cast<size_t>(e), std::memory_order_acq_rel)) {
+							}
+							return true;
+						});
 				}
 			}
+			return 0;
+			});
+
+		const size_t winner = answer.load();
+		if (winner < entries.size()) {
+			const uint64_t position = best[winner].load();
+			found[winner].push_back(MakeResult(static_cast<int>(winner),
+				static_cast<int>(position & 0xFFFFFFFF), static_cast<int>(position >> 32)));
+		}
+		// Entries after the answer were dropped unsearched; the caller handles them
+		found.resize(std::min(found.size(), winner + 1));
+	}
+
+	for (size_t e = 0; e < found.size(); ++e) {
+		results[entries[e].index] = std::move(found[e]);
+	}
+	return results;
+}
+
+// ============================================================================
+// SCALE STRATEGY: Search a downscaled source instead of the full frame
+// ============================================================================
+// Description:
+//   A template scaled up by s >= 2 covers f x f source blocks per template
+//   pixel block, with f the power of two <= s. Instead of scanning the full
+//   frame with the scaled template, the search runs on the frame's 1/f box
+//   level (built once per octave and shared by every scale and target) and
+//   maps hits back to full resolution.
+//
+// Algorithm:
+//   1. As in the pyramid, a match at x lands on coarse block (x + rx) / f with
+//      rx = (-x) mod f, so the scaled template is box-downsampled once per
+//      phase (rx, ry); block means within tolerance stay within tolerance + 1
+//   2. All f*f phase templates are found in one pass over the coarse level
+//      by the multi-template engine (phases it cannot key are searched
+//      individually)
+//   3. Hits map back as (X*f - rx, Y*f - ry) and are verified in scan order
+//      with the full-resolution kernel, so results equal SearchForBitmap's
+//
+// Cost model (per scale, in pixel visits):
+//   full frame:  one anchor probe per position, (W - w + 1) * (H - h + 1)
+//   octave:      W*H/f^2 bucket lookups at SOURCE_OCTAVE_LOOKUP_COST each,
+//                plus the level build W*H split across the scales sharing it
+//
+// Notes:
+//   Scales below 1 shrink the template, where the cheaper equivalent would be
+//   upsampling the source; only scales >= 2 use this strategy.
+// ============================================================================
+#define SOURCE_OCTAVE_MIN_TEMPLATE 8
+#define SOURCE_OCTAVE_LOOKUP_COST 2
+
+// Returns the level factor to search the scaled template on, or 0 for the full frame
+int ChooseSourceOctave(const PixelBuffer& Source, const PixelBuffer& ScaledTarget, float scale,
+	int tolerance, int scales_in_octave) {
+	if (scale < 2.0f || tolerance > PYRAMID_MAX_TOLERANCE) return 0;
+	int factor = 2;
+	while (factor < 8 && scale >= factor * 2.0f) factor *= 2;
+	while (factor > 1 && std::min(ScaledTarget.width, ScaledTarget.height) / factor < SOURCE_OCTAVE_MIN_TEMPLATE) factor /= 2;
+	if (factor < 2) return 0;
+
+	const int64_t pixels = static_cast<int64_t>(Source.width) * Source.height;
+	const int64_t full_cost = static_cast<int64_t>(Source.width - ScaledTarget.width + 1) *
+		(Source.height - ScaledTarget.height + 1);
+	const int64_t octave_cost = pixels / (factor * factor) * SOURCE_OCTAVE_LOOKUP_COST +
+		pixels / std::max(1, scales_in_octave) +
+		static_cast<int64_t>(ScaledTarget.width) * ScaledTarget.height;
+	return octave_cost < full_cost ? factor : 0;
+}
+
+// nullopt when the level cannot be built; the caller then searches the full frame
+std::optional<std::vector<MatchResult>> SearchSourceOctave(
+	const PixelBuffer& Source, SourceAnalysis& analysis, const PixelBuffer& Target, int factor,
+	int search_left, int search_top, int tolerance, bool transparent_enabled,
+	bool find_all, float scale_factor, const std::wstring& source_file,
+	std::wstring& backend_used, int max_results = 0, bool non_overlapping = false) {
+
+	SourceAnalysis* coarse = analysis.Downsampled(factor);
+	if (!coarse) return std::nullopt;
+
+	const int f = factor;
+	const int alpha_threshold = transparent_enabled ? ComputeAlphaThreshold(true, tolerance) : 0;
+	std::vector<std::optional<PixelBuffer>> phases;
+	for (int ry = 0; ry < f; ++ry) {
+		for (int rx = 0; rx < f; ++rx) {
+			PixelBuffer phase = DownsampleBox(Target, f, rx, ry, alpha_threshold);
+			if (phase.IsValid()) phases.push_back(std::move(phase));
+			else phases.push_back(std::nullopt);
+		}
+	}
+
+	std::wstring coarse_backend;
+	auto phase_results = SearchForBitmaps(coarse->Source(), phases, 0, 0, 0, tolerance + 1, true, {}, coarse_backend);
+
+	const int x_end = Source.width - Target.width + 1;
+	const int y_end = Source.height - Target.height + 1;
+	std::vector<std::pair<int, int>> coarse_hits;  // (y, x) at full resolution
+	for (size_t p = 0; p < phases.size(); ++p) {
+		if (!phases[p]) continue;
+		const int rx = static_cast<int>(p) % f;
+		const int ry = static_cast<int>(p) / f;
+		if (!phase_results[p]) {
+			std::wstring phase_backend;
+			phase_results[p] = SearchForBitmap(coarse->Source(), *phases[p], 0, 0, tolerance + 1,
+				transparent_enabled, true, scale_factor, source_file, phase_backend, coarse);
 		}
+		for (const auto& m : *phase_results[p]) {
+			const int x = m.x * f - rx;
+			const int y = m.y * f - ry;
+			if (x >= 0 && y >= 0 && x < x_end && y < y_end) coarse_hits.emplace_back(y, x);
+		}
+	}
+	std::sort(coarse_hits.begin(), coarse_hits.end());
+
+	PixelComparison::TemplateTables tables;
+	const PixelComparison::MatchFn Match = PixelComparison::SelectMatch(Target, transparent_enabled, tolerance, tables);
+	std::optional<OccupancyMap> occupancy;
+	if (find_all && non_overlapping) occupancy.emplace(x_end, y_end, Target.width, Target.height);
+	const size_t result_limit = !find_all ? 1 : (max_results > 0 ? static_cast<size_t>(max_results) : SIZE_MAX);
+
+	std::vector<MatchResult> matches;
+	for (const auto& [y, x] : coarse_hits) {
+		if (occupancy && occupancy->IsSet(x, y)) continue;
+		if (!Match(Source, Target, x, y, tolerance, tables)) continue;
+		if (occupancy) occupancy->Mark(x, y);
+		matches.push_back(MatchResult(x + search_left, y + search_top, Target.width, Target.height, scale_factor, source_file));
+		if (matches.size() >= result_limit) break;
 	}
 
+	backend_used = std::wstring(SimdBackendName()) + L"+Octave" + std::to_wstring(f) + L"x";
 	return matches;
 }
 
+// ============================================================================
+// SCALE GUIDE: Coarse SAD ordering of the scale sweep
+// ============================================================================
+// Description:
+//   First-match scale searches stop at the first scale that matches, so the
+//   order the scales are tried in decides how many full scans run. A cheap
+//   score can rank the scales first and the full searches follow that
+//   ranking. Chosen with ImageSearch_SetOption(L"ScaleSweep", n).
+//
+// Algorithm:
+//   1. Each scale is scored on the source's 1/f box level: the template is
+//      area-resampled to scale / f and the best mean absolute difference over
+//      all coarse positions is its score (rows abort once they exceed the
+//      best so far). Scales that round to the same coarse size share a score
+//   2. Ranked sweep (1): every scale is searched, best score first
+//   3. Adaptive sweep (2): only the SCALE_GUIDE_FULL_SCANS best scores within
+//      tolerance + SCALE_GUIDE_SCORE_SLACK get a full search, then the sweep
+//      ends. A target the coarse level cannot rank near the top is missed
+//
+// Notes:
+//   The plain sweep (0, default) skips the scoring and searches every scale
+//   smallest first. Each full scan already runs coarse-to-fine, so the
+//   scoring pass (two box levels plus one SAD per coarse size) is only
+//   recovered when full scans are expensive. Transparent template pixels
+//   are masked out of the score. Falls back to the plain order when the
+//   coarse template would be too small to rank.
+// ============================================================================
+#define SCALE_GUIDE_MIN_SCALES 6
+#define SCALE_GUIDE_MIN_COARSE_SIDE 4
+#define SCALE_GUIDE_FULL_SCANS 8
+#define SCALE_GUIDE_SCORE_SLACK 32
+
+enum class ScaleSweep : int { Plain = 0, Ranked = 1, Adaptive = 2 };
+
+static std::atomic<int> g_scale_sweep{ static_cast<int>(ScaleSweep::Plain) };  // ImageSearch_SetOption(L"ScaleSweep", n)
+
+namespace ScaleGuide {
+	// SAD of n pixels; mask clears transparent template pixels and all alpha bytes
+	inline uint32_t RowSad(const COLORREF* src, const COLORREF* tpl, const COLORREF* mask, int n) {
+		uint32_t sad = 0;
+		int i = 0;
+#ifndef _WIN64
+		if (g_is_sse2_supported.load(std::memory_order_relaxed))
+#endif
+		{
+			__m128i acc = _mm_setzero_si128();
+			for (; i + 4 <= n; i += 4) {
+				const __m128i s = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i)));
+				acc = _mm_add_epi64(acc, _mm_sad_epu8(s, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tpl + i))));
+			}
+			sad = static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+		}
+		for (; i < n; ++i) {
+			const COLORREF s = src[i] & mask[i];
+			sad += std::abs(static_cast<int>(GetRValue(s)) - GetRValue(tpl[i])) +
+				std::abs(static_cast<int>(GetGValue(s)) - GetGValue(tpl[i])) +
+				std::abs(static_cast<int>(GetBValue(s)) - GetBValue(tpl[i]));
+		}
+		return sad;
+	}
+
+	// Mean absolute channel difference of the best coarse position (lower is better)
+	inline double Score(SourceAnalysis& level, const PixelBuffer& tpl, bool transparent_enabled, int alpha_threshold) {
+		const PixelBuffer& coarse = level.Source();
+		std::vector<COLORREF> masked(tpl.pixels.size()), mask(tpl.pixels.size());
+		int64_t opaque = 0;
+		uint32_t sums[3] = { 0, 0, 0 };
+		for (size_t i = 0; i < tpl.pixels.size(); ++i) {
+			const bool keep = !transparent_enabled || static_cast<int>((tpl.pixels[i] >> 24) & 0xFF) >= alpha_threshold;
+			mask[i] = keep ? 0x00FFFFFF : 0;
+			masked[i] = tpl.pixels[i] & mask[i];
+			opaque += keep;
+			sums[0] += GetRValue(masked[i]);
+			sums[1] += GetGValue(masked[i]);
+			sums[2] += GetBValue(masked[i]);
+		}
+		if (opaque == 0) return 0.0;
+
+		// Successive elimination: the SAD is at least the difference of the
+		// window sums, which the integral tables give in O(1)
+		const bool use_bound = opaque == static_cast<int64_t>(tpl.pixels.size()) && level.EnsureIntegral();
+
+		uint64_t best = UINT64_MAX;
+		for (int y = 0; y + tpl.height <= coarse.height; ++y) {
+			for (int x = 0; x + tpl.width <= coarse.width; ++x) {
+				if (use_bound) {
+					uint64_t bound = 0;
+					for (int c = 0; c < 3; ++c) {
+						bound += std::abs(static_cast<int64_t>(level.WindowSum(c, x, y, tpl.width, tpl.height)) - sums[c]);
+					}
+					if (bound >= best) continue;
+				}
+				uint64_t sad = 0;
+				for (int row = 0; row < tpl.height && sad < best; ++row) {
+					sad += RowSad(&coarse.pixels[(y + row) * coarse.width + x], &masked[row * tpl.width],
+						&mask[row * tpl.width], tpl.width);
+				}
+				best = std::min(best, sad);
+			}
+		}
+		return static_cast<double>(best) / (opaque * 3);
+	}
+
+	// Indices of scales in the order they should be searched; in adaptive
+	// mode only the scales worth a full search
+	inline std::vector<int> Order(SourceAnalysis& analysis, const PixelBuffer& Target,
+		const std::vector<float>& scales, bool transparent_enabled, int tolerance, ScaleSweep sweep) {
+		std::vector<int> order(scales.size());
+		for (size_t i = 0; i < scales.size(); ++i) order[i] = static_cast<int>(i);
+		if (sweep == ScaleSweep::Plain || scales.size() < SCALE_GUIDE_MIN_SCALES) return order;
+
+		const int side = std::min(Target.width, Target.height);
+		const int alpha_threshold = ComputeAlphaThreshold(transparent_enabled, tolerance);
+
+		// Neighbouring scales often round to the same coarse template; each
+		// distinct (factor, w, h) is resampled and scored once
+		std::map<std::tuple<int, int, int>, double> scored;
+		std::vector<std::pair<double, int>> ranked;
+		for (int i = 0; i < static_cast<int>(scales.size()); ++i) {
+			// Coarsest level that leaves the template big enough to rank
+			int factor = 8;
+			while (factor > 1 && side * scales[i] / factor < SCALE_GUIDE_MIN_COARSE_SIDE) factor /= 2;
+			SourceAnalysis* coarse = factor > 1 ? analysis.Downsampled(factor) : nullptr;
+			if (!coarse) return order;
+
+			const int w = static_cast<int>(std::round(Target.width * scales[i] / factor));
+			const int h = static_cast<int>(std::round(Target.height * scales[i] / factor));
+			if (w <= 0 || h <= 0 || w > coarse->Source().width || h > coarse->Source().height) continue;
+
+			auto it = scored.find({ factor, w, h });
+			if (it == scored.end()) {
+				PixelBuffer tpl = Resample::Scale(Target, w, h, ScaleFilter::Area);
+				it = scored.emplace(std::make_tuple(factor, w, h), Score(*coarse, tpl, transparent_enabled, alpha_threshold)).first;
+			}
+			ranked.emplace_back(it->second, i);
+		}
+		if (ranked.empty()) return order;
+		std::stable_sort(ranked.begin(), ranked.end());
+
+		std::vector<char> taken(scales.size(), 0);
+		order.clear();
+		for (const auto& [score, i] : ranked) {
+			if (sweep == ScaleSweep::Adaptive &&
+				(order.size() >= SCALE_GUIDE_FULL_SCANS || score > tolerance + SCALE_GUIDE_SCORE_SLACK)) break;
+			taken[i] = 1;
+			order.push_back(i);
+		}
+		if (sweep == ScaleSweep::Ranked) {
+			for (size_t i = 0; i < scales.size(); ++i) {
+				if (!taken[i]) order.push_back(static_cast<int>(i));
+			}
+		}
+		return order;
+	}
+}
 enum class SearchMode {
 	ScreenSearch,
 	SearchImageInImage,
@@ -1709,6 +5246,7 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 	std::wstringstream result_stream;
 
 	int tolerance = std::clamp(params.tolerance, 0, 255);
+	const ImageDecoder decoder = static_cast<ImageDecoder>(g_image_decoder.load(std::memory_order_relaxed));
 	float min_scale = std::clamp(params.min_scale, 0.1f, 5.0f);
 	float max_scale = std::clamp(params.max_scale, min_scale, 5.0f);
 	float scale_step = std::clamp(params.scale_step, 0.01f, 1.0f);
@@ -1801,7 +5339,7 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 			return result_stream.str();
 		}
 
-		Source_opt = LoadImageFromFile_GDI(params.source_image);
+		Source_opt = LoadImageFromFile(params.source_image, decoder);
 		Source_source = params.source_image;
 
 	}
@@ -1877,6 +5415,7 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 	}
 
 	const PixelBuffer& Source = *Source_opt;
+	SourceAnalysis source_analysis(Source);
 
 	const wchar_t* target_file_list = nullptr;
 	if (params.mode == SearchMode::ScreenSearch) {
@@ -1937,26 +5476,39 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 	}
 	else if (target_files.size() > 1) {
 		for (const auto& file : target_files) {
-			load_futures.push_back(std::async(std::launch::async, [file]() {
-				return LoadImageFromFile_GDI(file);
+			load_futures.push_back(ThreadPool::Instance().Submit([file, decoder]() {
+				return LoadImageFromFile(file, decoder);
 				}));
 		}
 	}
 	else {
 		load_futures.push_back(std::async(std::launch::deferred, [&]() {
-			return LoadImageFromFile_GDI(target_files[0]);
+			return LoadImageFromFile(target_files[0], decoder);
 			}));
 	}
 
 	std::vector<MatchResult> all_matches;
 	bool find_all = (params.max_results >= 2);
+	const bool non_overlapping = find_all && g_non_overlapping_matches.load(std::memory_order_relaxed);
 	int cache_hits = 0, cache_misses = 0;
 	std::wstring backend_used;
 
 	bool skip_scaling = (std::abs(min_scale - 1.0f) < 0.001f && std::abs(max_scale - 1.0f) < 0.001f);
 
-	for (size_t i = 0; i < load_futures.size(); ++i) {
-		auto Target_opt = load_futures[i].get();
+	std::vector<std::optional<PixelBuffer>> targets;
+	targets.reserve(load_futures.size());
+	for (auto& fut : load_futures) {
+		targets.push_back(ThreadPool::Instance().Await(fut));
+	}
+
+	// Several unscaled targets share one pass over the source, run when the
+	// first target needs a full search; cache handling stays per target
+	const bool use_multi_template = skip_scaling && targets.size() >= MULTI_TEMPLATE_MIN_TARGETS;
+	bool multi_template_ran = false;
+	std::vector<std::optional<std::vector<MatchResult>>> multi_template_results;
+
+	for (size_t i = 0; i < targets.size(); ++i) {
+		const auto& Target_opt = targets[i];
 		if (!Target_opt || !Target_opt->IsValid()) continue;
 
 		const PixelBuffer& Target = *Target_opt;
@@ -1965,8 +5517,12 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 
 		std::vector<MatchResult> current_file_matches;
 
+		// Matches this target can still contribute to the reported prefix
+		const int remaining_results = find_all
+			? params.max_results - static_cast<int>(all_matches.size()) : 1;
+
 		if (skip_scaling) {
-			std::wstring cache_key;
+			LocationKey cache_key;
 			if (!source_file.empty() && params.use_cache) {
 				cache_key = GenerateCacheKey(Source_source, source_file, tolerance, transparent_enabled, 1.0f);
 				// Load cache from disk if not already in memory
@@ -1977,7 +5533,7 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 
 			bool found_in_cache = false;
 
-			if (!cache_key.empty() && params.use_cache) {
+			if (cache_key.IsValid() && params.use_cache) {
 				auto cached_entry = GetCachedLocation(cache_key);
 				if (cached_entry) {
 					// Validate cached position is within current search region
@@ -2031,15 +5587,32 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 			// CRITICAL FIX: Always add matches to results, regardless of cache setting
 			// Bug: Previously matches were only added when use_cache=1, causing search to fail when use_cache=0
 			if (!found_in_cache || find_all) {
-				auto matches = SearchForBitmap(Source, Target, search_offset_x, search_offset_y,
-					tolerance, transparent_enabled, find_all, 1.0f, source_file, backend_used);
+				if (use_multi_template && !multi_template_ran) {
+					multi_template_results = SearchForBitmaps(Source, targets, i, search_offset_x, search_offset_y,
+						tolerance, find_all, target_files, backend_used, non_overlapping ? 0 : remaining_results);
+					multi_template_ran = true;
+				}
+
+				std::vector<MatchResult> matches;
+				if (i < multi_template_results.size() && multi_template_results[i]) {
+					matches = std::move(*multi_template_results[i]);
+					if (non_overlapping) {
+						SuppressOverlapsInScanOrder(matches, search_offset_x, search_offset_y,
+							Source.width - Target.width + 1, Source.height - Target.height + 1);
+					}
+				}
+				else {
+					matches = SearchForBitmap(Source, Target, search_offset_x, search_offset_y,
+						tolerance, transparent_enabled, find_all, 1.0f, source_file, backend_used, &source_analysis,
+						remaining_results, non_overlapping);
+				}
 
 				// Always add matches to results, regardless of cache setting
 				if (!matches.empty()) {
 					current_file_matches.insert(current_file_matches.end(), matches.begin(), matches.end());
 
 					// Save to cache only if caching is enabled
-					if (params.use_cache && !cache_key.empty()) {
+					if (params.use_cache && cache_key.IsValid()) {
 						POINT new_pos = { matches[0].x, matches[0].y };
 						CacheEntry entry;
 						entry.position = new_pos;
@@ -2056,53 +5629,86 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 			for (float scale = min_scale; scale <= max_scale; scale += scale_step) {
 				scales.push_back(std::round(scale * 10.0f) / 10.0f);
 			}
+			// Steps finer than the 0.1 rounding would repeat scales
+			scales.erase(std::unique(scales.begin(), scales.end()), scales.end());
+
+			// Searches one scaled template with the cheaper of the full-frame and
+			// downscaled-source strategies
+			auto SearchScaled = [&](const PixelBuffer& Scaled, float scale, bool scale_find_all,
+				std::wstring& scale_backend, int limit) {
+				const int octave = static_cast<int>(std::floor(std::log2(std::max(scale, 1.0f))));
+				const int scales_in_octave = static_cast<int>(std::count_if(scales.begin(), scales.end(), [&](float other) {
+					return static_cast<int>(std::floor(std::log2(std::max(other, 1.0f)))) == octave;
+					}));
+				const int factor = ChooseSourceOctave(Source, Scaled, scale, tolerance, scales_in_octave);
+				if (factor) {
+					auto octave_matches = SearchSourceOctave(Source, source_analysis, Scaled, factor, search_offset_x, search_offset_y,
+						tolerance, transparent_enabled, scale_find_all, scale, source_file, scale_backend, limit, non_overlapping);
+					if (octave_matches) return std::move(*octave_matches);
+				}
+				return SearchForBitmap(Source, Scaled, search_offset_x, search_offset_y,
+					tolerance, transparent_enabled, scale_find_all, scale, source_file, scale_backend, &source_analysis,
+					limit, non_overlapping);
+				};
 
 			if (find_all && scales.size() > 1) {
 				std::vector<std::future<std::vector<MatchResult>>> scale_futures;
-
-				for (float scale : scales) {
-					scale_futures.push_back(std::async(std::launch::async, [&, scale]() {
+				// Results are reported in scale order, so once the leading
+				// scales fill the budget the remaining ones are skipped. Cross-scale
+				// suppression runs after the merge, so it needs every scale in full.
+				const int scale_budget = non_overlapping ? 0 : remaining_results;
+				PrefixBudget budget(static_cast<int>(scales.size()), 1, scale_budget);
+
+				for (int s = 0; s < static_cast<int>(scales.size()); ++s) {
+					scale_futures.push_back(ThreadPool::Instance().Submit([&, s]() {
+						const float scale = scales[s];
 						std::vector<MatchResult> scale_matches;
+						if (!budget.IsNeeded(s)) return scale_matches;
 
 						int newW = static_cast<int>(std::round(Target.width * scale));
 						int newH = static_cast<int>(std::round(Target.height * scale));
-						if (newW <= 0 || newH <= 0 || newW > Source.width || newH > Source.height) {
-							return scale_matches;
-						}
-
-						auto scaled_opt = ScaleBitmap_GDI(Target, newW, newH);
-						if (scaled_opt && scaled_opt->IsValid()) {
-							std::wstring thread_backend;
-							scale_matches = SearchForBitmap(Source, *scaled_opt, search_offset_x, search_offset_y,
-								tolerance, transparent_enabled, true, scale, source_file, thread_backend);
+						if (newW > 0 && newH > 0 && newW <= Source.width && newH <= Source.height) {
+							auto scaled_opt = ScaleBitmap(Target, newW, newH);
+							if (scaled_opt && scaled_opt->IsValid()) {
+								std::wstring thread_backend;
+								scale_matches = SearchScaled(*scaled_opt, scale, true, thread_backend, scale_budget);
+							}
 						}
+						budget.Complete(s, scale_matches.size());
 						return scale_matches;
 						}));
 				}
 
 				for (auto& fut : scale_futures) {
-					auto scale_results = fut.get();
+					auto scale_results = ThreadPool::Instance().Await(fut);
 					if (!scale_results.empty()) {
 						current_file_matches.insert(current_file_matches.end(), scale_results.begin(), scale_results.end());
 					}
 				}
 
+				// Non-maximum suppression across scales: smaller scales come first and win
+				if (non_overlapping) SuppressOverlaps(current_file_matches);
+
 			}
 			else {
-				for (float scale : scales) {
+				// First match: scale order from the ScaleSweep option
+				const ScaleSweep sweep = static_cast<ScaleSweep>(g_scale_sweep.load(std::memory_order_relaxed));
+				const std::vector<int> order = ScaleGuide::Order(source_analysis, Target, scales, transparent_enabled, tolerance, sweep);
+				for (int s : order) {
+					const float scale = scales[s];
 					int newW = static_cast<int>(std::round(Target.width * scale));
 					int newH = static_cast<int>(std::round(Target.height * scale));
 					if (newW <= 0 || newH <= 0 || newW > Source.width || newH > Source.height) {
 						continue;
 					}
 
-					auto scaled_opt = ScaleBitmap_GDI(Target, newW, newH);
+					auto scaled_opt = ScaleBitmap(Target, newW, newH);
 					if (scaled_opt && scaled_opt->IsValid()) {
-						auto matches = SearchForBitmap(Source, *scaled_opt, search_offset_x, search_offset_y,
-							tolerance, transparent_enabled, find_all, scale, source_file, backend_used);
+						auto matches = SearchScaled(*scaled_opt, scale, find_all, backend_used,
+							remaining_results - static_cast<int>(current_file_matches.size()));
 						if (!matches.empty()) {
 							current_file_matches.insert(current_file_matches.end(), matches.begin(), matches.end());
-							if (!find_all) break;
+							if (current_file_matches.size() >= static_cast<size_t>(remaining_results)) break;
 						}
 					}
 				}
@@ -2111,7 +5717,7 @@ std::wstring UnifiedImageSearch(const SearchParams& params) {
 
 		if (!current_file_matches.empty()) {
 			all_matches.insert(all_matches.end(), current_file_matches.begin(), current_file_matches.end());
-			if (!find_all) break;
+			if (!find_all || all_matches.size() >= static_cast<size_t>(params.max_results)) break;
 		}
 	}
 
@@ -3154,11 +6760,7 @@ extern "C" __declspec(dllexport) HBITMAP WINAPI ImageSearch_hBitmapLoad(
 //   Thread-safe. Acquires cache mutex before clearing.
 // ============================================================================
 extern "C" __declspec(dllexport) void WINAPI ImageSearch_ClearCache() {
-	{
-		std::unique_lock lock(g_cache_mutex);
-		g_location_cache_lru.clear();
-		g_location_cache_index.clear();
-	}
+	g_location_cache.Clear();
 
 	try {
 		std::wstring cache_dir = GetCacheBaseDir();
@@ -3175,10 +6777,72 @@ extern "C" __declspec(dllexport) void WINAPI ImageSearch_ClearCache() {
 	}
 	catch (...) {}
 
-	{
-		std::lock_guard<std::mutex> lock(g_bitmap_cache_mutex);
-		g_bitmap_cache.clear();
+	g_bitmap_cache.Clear();
+}
+
+// ============================================================================
+// EXPORTED FUNCTION: ImageSearch_SetOption
+// ============================================================================
+// Description:
+//   Sets a process-wide search option. Options stay in effect for every
+//   later search until changed again.
+//
+// Options (names are case-insensitive):
+//   NonOverlapping - 1: find-all searches skip positions whose window overlaps
+//                    an earlier match, and matches from different scales are
+//                    suppressed when they overlap (default 0)
+//   ScaleFilter    - Template resampling filter for scaled searches:
+//                    0 = bicubic (default), 1 = bilinear, 2 = area
+//   ScaleSweep     - First-match scale searches: 0 = every scale, smallest
+//                    first (default); 1 = every scale, best coarse score
+//                    first; 2 = only the best coarse scores
+//   Decoder        - Image file decoder: 0 = GDI+ (default), 1 = built-in
+//                    PNG/BMP decoder, falling back to GDI+ for other files
+//   LocationCacheSize - Entries kept in the in-memory location cache
+//                    (default 100, minimum 1)
+//   BitmapCacheMB  - Memory budget in MB for decoded/scaled bitmaps
+//                    (default 256 on x64, 64 on x86, minimum 1)
+//
+// Returns:
+//   1 if the option was recognized and set, 0 otherwise
+//
+// Thread Safety:
+//   Thread-safe. Searches already running keep the value they started with.
+// ============================================================================
+extern "C" __declspec(dllexport) int WINAPI ImageSearch_SetOption(const wchar_t* name, int value) {
+	if (!name) return 0;
+
+	if (_wcsicmp(name, L"NonOverlapping") == 0) {
+		g_non_overlapping_matches.store(value != 0, std::memory_order_relaxed);
+		return 1;
 	}
+	if (_wcsicmp(name, L"ScaleFilter") == 0) {
+		if (value < static_cast<int>(ScaleFilter::Bicubic) || value > static_cast<int>(ScaleFilter::Area)) return 0;
+		g_scale_filter.store(value, std::memory_order_relaxed);
+		return 1;
+	}
+	if (_wcsicmp(name, L"ScaleSweep") == 0) {
+		if (value < static_cast<int>(ScaleSweep::Plain) || value > static_cast<int>(ScaleSweep::Adaptive)) return 0;
+		g_scale_sweep.store(value, std::memory_order_relaxed);
+		return 1;
+	}
+	if (_wcsicmp(name, L"Decoder") == 0) {
+		if (value < static_cast<int>(ImageDecoder::Gdiplus) || value > static_cast<int>(ImageDecoder::Native)) return 0;
+		g_image_decoder.store(value, std::memory_order_relaxed);
+		return 1;
+	}
+	if (_wcsicmp(name, L"LocationCacheSize") == 0) {
+		if (value < 1) return 0;
+		g_location_cache.SetCapacity(static_cast<size_t>(value));
+		return 1;
+	}
+	if (_wcsicmp(name, L"BitmapCacheMB") == 0) {
+		if (value < 1 || static_cast<size_t>(value) > (SIZE_MAX >> 20)) return 0;
+		g_bitmap_cache.SetBudget(static_cast<size_t>(value) << 20);
+		return 1;
+	}
+
+	return 0;
 }
 
 extern "C" __declspec(dllexport) const wchar_t* WINAPI ImageSearch_GetVersion() {
@@ -3194,24 +6858,47 @@ extern "C" __declspec(dllexport) const wchar_t* WINAPI ImageSearch_GetSysInfo()
 	std::call_once(g_feature_detection_flag, DetectFeatures);
 
 	EnumerateMonitors();
+	const CacheStats bitmap_stats = g_bitmap_cache.GetStats();
 
 	swprintf_s(info_buffer, _countof(info_buffer),
 #ifdef _WIN64
-		L"CPU: AVX2=%s AVX512=%s | Screen: %dx%d | Monitors=%d | LocationCache: %zu/%d | BitmapCache: %zu/%d | PoolSize: %d",
+		L"CPU: AVX2=%s AVX512=%s | Screen: %dx%d | Monitors=%d | LocationCache: %zu/%zu | BitmapCache: %lluKB/%lluKB | PoolSize: %d",
 		g_is_avx2_supported.load() ? L"Yes" : L"No",
 		g_is_avx512_supported.load() ? L"Yes" : L"No",
 #else
-		L"CPU: SSE2=%s | Screen: %dx%d | Monitors=%d | LocationCache: %zu/%d | BitmapCache: %zu/%d | PoolSize: %d",
+		L"CPU: SSE2=%s | Screen: %dx%d | Monitors=%d | LocationCache: %zu/%zu | BitmapCache: %lluKB/%lluKB | PoolSize: %d",
 		g_is_sse2_supported.load() ? L"Yes" : L"No",
 #endif
 		GetSystemMetrics(SM_CXVIRTUALSCREEN), GetSystemMetrics(SM_CYVIRTUALSCREEN),
 		static_cast<int>(g_monitors.size()),
-		g_location_cache_lru.size(), MAX_CACHED_LOCATIONS,
-		g_bitmap_cache.size(), MAX_CACHED_BITMAPS,
+		g_location_cache.Size(), g_location_cache.Capacity(),
+		bitmap_stats.resident_bytes >> 10, bitmap_stats.budget_bytes >> 10,
 		g_pixel_pool_size.load(std::memory_order_relaxed));
 	return info_buffer;
 }
 
+// ============================================================================
+// EXPORTED FUNCTION: ImageSearch_GetCacheStats
+// ============================================================================
+// Description:
+//   Reports the decoded/scaled bitmap cache counters since the DLL loaded.
+//
+// Returns:
+//   "ResidentBytes=n|BudgetBytes=n|Entries=n|Hits=n|Misses=n|Evictions=n"
+//
+// Thread Safety:
+//   Thread-safe. The string lives in a thread-local buffer until the next
+//   call on the same thread.
+// ============================================================================
+extern "C" __declspec(dllexport) const wchar_t* WINAPI ImageSearch_GetCacheStats() {
+	thread_local wchar_t stats_buffer[256];
+	const CacheStats stats = g_bitmap_cache.GetStats();
+	swprintf_s(stats_buffer, _countof(stats_buffer),
+		L"ResidentBytes=%llu|BudgetBytes=%llu|Entries=%llu|Hits=%llu|Misses=%llu|Evictions=%llu",
+		stats.resident_bytes, stats.budget_bytes, stats.entries, stats.hits, stats.misses, stats.evictions);
+	return stats_buffer;
+}
+
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
 	switch (ul_reason_for_call) {
 	case DLL_PROCESS_ATTACH:
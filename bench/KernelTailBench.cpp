@@ -0,0 +1,221 @@
+// =================================================================================================
+//  KernelTailBench - Row-tail cost of the AVX2/AVX512 match kernels
+//  Licensed under the MIT License. See LICENSE file for details.
+// =================================================================================================
+// Description:
+//   Times one full template match per call (every row compared, the template
+//   is on screen) for odd template widths. "scalar tail" is the kernel with
+//   the last width % lanes pixels of each row compared one by one, as before
+//   the masked-load tails; "masked tail" is the shipped kernel. The vector
+//   bodies are identical, so the difference is the tail alone.
+//
+// Build and run (x64 Native Tools prompt, from the repository root):
+//   cl /nologo /O2 /EHsc /std:c++20 bench\KernelTailBench.cpp /Fe:KernelTailBench.exe
+//   KernelTailBench.exe
+//
+// Output: ns per call, best of BENCH_ROUNDS, for each ISA the CPU supports.
+// =================================================================================================
+
+#include "../ImageSearchDLL.cpp"
+
+#include <cstdio>
+#include <random>
+
+#ifndef _WIN64
+#error KernelTailBench times the x64 AVX2/AVX512 kernels; build it for x64
+#endif
+
+#define BENCH_TEMPLATE_HEIGHT 32
+#define BENCH_CALLS 200000
+#define BENCH_ROUNDS 5
+#define BENCH_TOLERANCE 10
+
+namespace {
+	using namespace PixelComparison;
+
+	volatile int g_sink = 0;  // Keeps the timed calls from being optimized out
+
+	// Match_AVX2 with the pre-masked-load scalar tail
+	template<bool Transparent, bool Exact, int Width>
+	bool MatchScalarTail_AVX2(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables&) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(Transparent, tolerance);
+
+		const __m256i v_alpha_threshold = _mm256_set1_epi32(alpha_threshold);
+		const __m256i v_rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+		const __m256i v_tolerance8 = _mm256_set1_epi8(static_cast<char>(tolerance));
+
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+
+			int x = 0;
+			if constexpr (Width != WIDTH_NARROW) {
+				for (; x + 7 < source.width; x += 8) {
+					__m256i v_source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_row + x));
+					__m256i v_screen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(screen_row + x));
+					__m256i v_mismatch = Mismatch_AVX2<Transparent, Exact>(v_source, v_screen, v_alpha_threshold, v_rgb_mask, v_tolerance8);
+					if (!_mm256_testz_si256(v_mismatch, v_mismatch)) {
+						return false;
+					}
+				}
+			}
+
+			if constexpr (Width != WIDTH_MULTIPLE) {
+				for (; x < source.width; ++x) {
+					if (PixelMismatch<Transparent, Exact>(source_row[x], screen_row[x], alpha_threshold, tolerance)) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	// Match_AVX512 with the pre-masked-load scalar tail
+	template<bool Transparent, bool Exact, int Width>
+	bool MatchScalarTail_AVX512(const PixelBuffer& screen, const PixelBuffer& source,
+		int start_x, int start_y, int tolerance, const TemplateTables& tables) noexcept {
+		const int alpha_threshold = ComputeAlphaThreshold(Transparent, tolerance);
+		const __m512i v_tolerance8 = _mm512_set1_epi8(static_cast<char>(tolerance));
+		const int blocks = (source.width + 15) / 16;
+
+		for (int y = 0; y < source.height; ++y) {
+			const COLORREF* source_row = &source.pixels[y * source.width];
+			const COLORREF* screen_row = &screen.pixels[(start_y + y) * screen.width + start_x];
+			const uint64_t* row_care = Transparent ? tables.care_masks.data() + static_cast<size_t>(y) * blocks : nullptr;
+
+			int x = 0;
+			if constexpr (Width != WIDTH_NARROW) {
+				for (; x + 15 < source.width; x += 16) {
+					__m512i v_source = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(source_row + x));
+					__m512i v_screen = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(screen_row + x));
+					const uint64_t care = Transparent ? row_care[x / 16] : kRgbByteMask;
+					if (Mismatch_AVX512<Exact>(care, v_source, v_screen, v_tolerance8)) {
+						return false;
+					}
+				}
+			}
+
+			if constexpr (Width != WIDTH_MULTIPLE) {
+				for (; x < source.width; ++x) {
+					if (PixelMismatch<Transparent, Exact>(source_row[x], screen_row[x], alpha_threshold, tolerance)) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	template<template<bool, bool, int> class Kernel, bool Transparent, bool Exact>
+	MatchFn ForWidth(int width, int lanes) {
+		switch (ClassifyWidth(width, lanes)) {
+		case WIDTH_NARROW: return Kernel<Transparent, Exact, WIDTH_NARROW>::fn;
+		case WIDTH_MULTIPLE: return Kernel<Transparent, Exact, WIDTH_MULTIPLE>::fn;
+		default: return Kernel<Transparent, Exact, WIDTH_GENERAL>::fn;
+		}
+	}
+
+	template<bool T, bool E, int W> struct ScalarTailAVX2 { static constexpr MatchFn fn = &MatchScalarTail_AVX2<T, E, W>; };
+	template<bool T, bool E, int W> struct MaskedTailAVX2 { static constexpr MatchFn fn = &Match_AVX2<T, E, W>; };
+	template<bool T, bool E, int W> struct ScalarTailAVX512 { static constexpr MatchFn fn = &MatchScalarTail_AVX512<T, E, W>; };
+	template<bool T, bool E, int W> struct MaskedTailAVX512 { static constexpr MatchFn fn = &Match_AVX512<T, E, W>; };
+
+	struct Scene {
+		PixelBuffer screen;
+		PixelBuffer source;
+		int x = 0;
+		int y = 0;
+		TemplateTables tables;
+	};
+
+	// Random template pasted onto a random screen. Tolerance scenes nudge each
+	// channel by up to half the tolerance so the kernels compare real
+	// differences; transparent scenes clear every fifth template pixel and
+	// leave the screen behind it unrelated.
+	Scene MakeScene(int width, bool exact, bool transparent) {
+		std::mt19937 rng(width);
+		Scene scene;
+		scene.source.width = width;
+		scene.source.height = BENCH_TEMPLATE_HEIGHT;
+		scene.source.pixels.resize(static_cast<size_t>(width) * BENCH_TEMPLATE_HEIGHT);
+		for (size_t i = 0; i < scene.source.pixels.size(); ++i) {
+			const COLORREF alpha = transparent && i % 5 == 0 ? 0 : 0xFF000000;
+			scene.source.pixels[i] = alpha | (rng() & 0x00F0F0F0) | 0x00080808;
+		}
+		scene.source.has_alpha = transparent;
+
+		scene.screen.width = 256;
+		scene.screen.height = BENCH_TEMPLATE_HEIGHT + 16;
+		scene.screen.pixels.resize(static_cast<size_t>(scene.screen.width) * scene.screen.height);
+		for (size_t i = 0; i < scene.screen.pixels.size(); ++i) scene.screen.pixels[i] = rng() & 0x00FFFFFF;
+
+		scene.x = 37;
+		scene.y = 5;
+		for (int ty = 0; ty < scene.source.height; ++ty) {
+			for (int tx = 0; tx < width; ++tx) {
+				const COLORREF source_pixel = scene.source.pixels[ty * width + tx];
+				if ((source_pixel >> 24) == 0) continue;
+				const COLORREF nudge = exact ? 0 : (rng() % (BENCH_TOLERANCE / 2 + 1)) * 0x010101;
+				scene.screen.pixels[(scene.y + ty) * scene.screen.width + scene.x + tx] = (source_pixel + nudge) & 0x00FFFFFF;
+			}
+		}
+		return scene;
+	}
+
+	// Best-of-rounds ns per call; -1 if the kernel does not report the match
+	double Time(MatchFn match, const Scene& scene, int tolerance) {
+		if (!match(scene.screen, scene.source, scene.x, scene.y, tolerance, scene.tables)) return -1.0;
+
+		double best = 1e300;
+		for (int round = 0; round < BENCH_ROUNDS; ++round) {
+			int matched = 0;
+			const auto t0 = std::chrono::steady_clock::now();
+			for (int i = 0; i < BENCH_CALLS; ++i) {
+				matched += match(scene.screen, scene.source, scene.x, scene.y, tolerance, scene.tables);
+			}
+			const auto t1 = std::chrono::steady_clock::now();
+			g_sink = matched;
+			best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_CALLS);
+		}
+		return best;
+	}
+
+	template<bool Transparent, bool Exact,
+		template<bool, bool, int> class Before, template<bool, bool, int> class After>
+	void Row(const char* isa, int lanes, int width) {
+		const int tolerance = Exact ? 0 : BENCH_TOLERANCE;
+		Scene scene = MakeScene(width, Exact, Transparent);
+		if constexpr (Transparent) {
+			if (lanes == 16) BuildCareMasks_AVX512(scene.source, ComputeAlphaThreshold(true, tolerance), scene.tables.care_masks);
+		}
+		const double before = Time(ForWidth<Before, Transparent, Exact>(width, lanes), scene, tolerance);
+		const double after = Time(ForWidth<After, Transparent, Exact>(width, lanes), scene, tolerance);
+		std::printf("%-7s %5d  %-11s %-5s %12.1f %12.1f %8.2fx\n", isa, width,
+			Transparent ? "transparent" : "opaque", Exact ? "exact" : "tol", before, after, before / after);
+	}
+
+	template<template<bool, bool, int> class Before, template<bool, bool, int> class After>
+	void Isa(const char* isa, int lanes) {
+		static const int kWidths[] = { 7, 9, 15, 17, 23, 31, 33 };
+		for (int width : kWidths) {
+			Row<false, false, Before, After>(isa, lanes, width);
+			Row<false, true, Before, After>(isa, lanes, width);
+			Row<true, false, Before, After>(isa, lanes, width);
+		}
+	}
+}
+
+int main() {
+	DetectCpuFeatures();
+	std::printf("%d rows per template, %d calls x %d rounds, ns per call (best round)\n\n",
+		BENCH_TEMPLATE_HEIGHT, BENCH_CALLS, BENCH_ROUNDS);
+	std::printf("%-7s %5s  %-11s %-5s %12s %12s %9s\n", "ISA", "width", "template", "mode", "scalar tail", "masked tail", "speedup");
+
+	if (g_is_avx2_supported.load(std::memory_order_relaxed)) Isa<ScalarTailAVX2, MaskedTailAVX2>("AVX2", 8);
+	else std::printf("AVX2    not supported, skipped\n");
+	if (g_is_avx512_supported.load(std::memory_order_relaxed)) Isa<ScalarTailAVX512, MaskedTailAVX512>("AVX512", 16);
+	else std::printf("AVX512  not supported, skipped\n");
+	return 0;
+}